@@ -0,0 +1,74 @@
+#ifdef BENCHMARK
+#include <avr/sleep.h>
+
+///////////////////////////////////////////////////////////////////////////////////////
+//BENCHMARK HARNESS (env:uno_bench, runs under simavr; see tools/bench.py)
+//Timer2 counts CPU cycles with a prescaler of 8, so every figure has an 8 cycle resolution.
+//Results are printed as "BENCH <name> <value>" lines and the simulator exits at "BENCH done".
+//Stack painting comes from motor_stand_master_memory.h, which must be included first.
+
+const int BENCH_ITERATIONS = 32;
+
+volatile unsigned long bench_overflows;
+volatile float bench_sink;   //results are stored here so the optimizer keeps the kernels
+
+ISR(TIMER2_OVF_vect){
+  bench_overflows++;
+}
+
+void bench_begin(){
+  TCCR2A = 0;
+  TCCR2B = _BV(CS21);
+  TCNT2 = 0;
+  TIMSK2 = _BV(TOIE2);
+  bench_overflows = 0;
+  sei();
+}
+
+unsigned long bench_ticks(){
+  uint8_t oldSREG = SREG;
+  cli();
+  unsigned long overflows = bench_overflows;
+  uint8_t count = TCNT2;
+  if((TIFR2 & _BV(TOV2)) && count < 255){ //overflow happened after cli()
+    overflows++;
+  }
+  SREG = oldSREG;
+  return (overflows << 8) | count;
+}
+
+void bench_report(const __FlashStringHelper* name, unsigned long value){
+  Serial.print(F("BENCH "));
+  Serial.print(name);
+  Serial.print(' ');
+  Serial.println(value);
+}
+
+//Reports the average cycle count of one pass of statement over BENCH_ITERATIONS passes
+#define BENCH(name, statement) do { \
+    unsigned long _bench_start = bench_ticks(); \
+    for(int _bench_i = 0; _bench_i < BENCH_ITERATIONS; _bench_i++){ statement; } \
+    bench_report(F(name), (bench_ticks() - _bench_start) * 8 / BENCH_ITERATIONS); \
+  } while(0)
+
+void bench_memory_report(){
+  bench_report(F("static_ram"), static_ram());
+  bench_report(F("peak_stack"), measure_peak_stack());
+}
+
+//Lets the serial buffer empty, then sleeps with interrupts off, which simavr treats as the end of the program
+void bench_end(){
+  bench_report(F("done"), 0);
+  Serial.flush();
+  cli();
+  sleep_enable();
+  sleep_cpu();
+}
+
+//Discards everything written to it; stands in for the LCD and Serial so only the formatting cost is measured
+class NullPrint : public Print {
+  public:
+    size_t write(uint8_t) { return 1; }
+};
+
+#endif
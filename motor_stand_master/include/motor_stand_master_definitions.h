@@ -2,7 +2,7 @@
 #include <Wire.h>
 #include <Keypad.h>
 #include <LiquidCrystal_I2C.h>
-#include <Servo.h>
+#include <EEPROM.h>
 
 ////////////////////////////////////////////////////////////////////////////////////////
 //LCD I2C address: 0x27
@@ -14,7 +14,10 @@ LiquidCrystal_I2C lcd(0x27,20,4);  // set the LCD address to 0x27 for a 20 chars
 
 
 const int PARAMETER_NUM = 5;
-const String parameter_names[] = {"TEST #:", "MAX THROTTLE (%):", "INCREMENT (%):", "MARKERS:", "INCR. LENGTH (s):"};
+const String parameter_names[] = {"TEST #:", "MAX (%/N/RPM):", "INCR (%/N/RPM):", "MARKERS:", "INCR. LENGTH (s):"}; //max and increment are % throttle in open loop, N or RPM when holding
+const int MAX_INPUT_LENGTH = 5; //enough digits for an RPM target
+const int TEST_NUMBER_LENGTH = 3; //the slave's TEST_/BRST_/HOLD_ file names must fit the SD library's 8.3 limit
+const int MAX_TEST_NUMBER = 999;
 String parameter_values[PARAMETER_NUM];
 int parameter_index;
 
@@ -25,6 +28,7 @@ const int TARE_NUM = 2;
 const String tare_names[] = {"KNOWN TORQUE:", "KNOWN THRUST:"};
 String tare_values[TARE_NUM];
 int tare_index;
+int tare_slave;                                 //index into slave_addresses of the stand taking the known load
 
 String input;
 
@@ -58,27 +62,140 @@ Keypad keypad = Keypad(makeKeymap(keys), rowPins, colPins, ROWS, COLS);
 //THROTTLE LOGIC DEFINITIONS
 //(For a HARGRAVE MICRODRIVE ESC, accepted PWM frequencies range from 50Hz to 499 Hz
 
-Servo esc; 
-
 const int MIN_THROTTLE = 1000;
 int MAX_THROTTLE;
 
-const int ESC_PIN = 3;
 int INCREMENT_TIME;
 const int THROTTLE_UP_DELAY = 10;
 
 int throttleIncrement;
 int pwm_increment;
-int cycle_length;
+int cycle_length; //open loop ramp position, shared by every ESC channel
 
 bool start_motor; 
 bool read_gradient;
+bool raw_capture; //slave logs unconverted counts for offline reprocessing
 volatile bool done_throttling;
 bool throttling_up;
 
 unsigned long prev_interval_timestamp;
 
+////////////////////////////////////////////////////////////////////////////////////////
+//ESC OUTPUT DRIVER DEFINITIONS
+//(Timer1 runs in fast PWM with ICR1 as TOP. Its overflow ISR raises every ESC pin at the start of each period and
+//the compare A/B ISRs drop channel 0/1. OCR1A/OCR1B are double buffered by the hardware, so a new setpoint always
+//lands on a period boundary. ESC channel n is paired with the nth slave found on the bus.
+//The pins are driven from those ISRs, not by the timer's own output pins (OC1A/OC1B are pins 9/10, which the keypad
+//rows use), so both edges come late by the interrupt latency: a few us normally, up to about 20 us when the
+//millis(), I2C or serial ISRs or a noInterrupts() section is in the way. On the 1000 us throttle span of the PWM
+//modes that is about 2%; OneShot125's 125 us span would see over 15%, so it is not offered)
+
+enum EscMode {ESC_STANDARD, ESC_PWM_400};
+const EscMode ESC_MODE = ESC_PWM_400; //must match the protocol the ESCs are set up for
+
+const unsigned int ESC_PERIOD_US = ESC_MODE == ESC_STANDARD ? 20000 : 2500;
+const unsigned int ESC_PERIOD_TICKS = ESC_PERIOD_US * 2; //prescaler 8 gives 2 ticks per us
+
+const int ESC_CHANNELS = 2;                     //one per Timer1 compare unit
+const int ESC_PINS[ESC_CHANNELS] = {3, 4};
+volatile uint8_t *esc_port[ESC_CHANNELS];
+uint8_t esc_mask[ESC_CHANNELS];
+int esc_cycle[ESC_CHANNELS];                    //last cycle length written to each channel
+bool esc_running;
+
+////////////////////////////////////////////////////////////////////////////////////////
+//SLAVE BUS DEFINITIONS
+//(Slaves answer at SLAVE_ADDRESS_FIRST plus the jumpers on their address pins. Run events go out as I2C general
+//calls so every slave gets them in the same transfer, which keeps their logs on one timebase)
+
+const int BROADCAST_ADDRESS = 0;
+const int SLAVE_ADDRESS_FIRST = 9;
+const int MAX_SLAVES = 4;
+int slave_addresses[MAX_SLAVES];
+int slave_count;
+int esc_count;                                  //channels in use, min(slave_count, ESC_CHANNELS)
+const int STATUS_LENGTH = 1 + 2 * sizeof(float) + sizeof(uint16_t); //ready byte, live thrust, live RPM, peak stack
+unsigned long run_start_timestamp;
+
 ////////////////////////////////////////////////////////////////////////////////////////
 //MANUAL OVERRIDE DEFINITIONS
+//(The e-stop switch and the slave's KILL_PIN are wired together onto INTERRUPT_PIN; either one pulling it low
+//forces the ESC to minimum from inside the ISR and latches every later write at minimum until the next test starts)
+
+const int INTERRUPT_PIN = 2;
+volatile bool esc_killed;
+
+////////////////////////////////////////////////////////////////////////////////////////
+//CLOSED-LOOP HOLD DEFINITIONS
+//(Steps a thrust or RPM target from INCREMENT up to MAX, holding each for INCR. LENGTH with a fixed rate PID
+//on the live readings the slave returns after its ready byte. Gains are a starting point; tune them per motor)
+
+enum ControlMode {OPEN_LOOP, HOLD_THRUST, HOLD_RPM};
+ControlMode control_mode;
+
+const int CONTROL_INTERVAL = 50;        //ms between PID updates; the load cells refresh at 10 SPS by default
+const float THRUST_KP = 20.0;           //us of PWM per N of error
+const float THRUST_KI = 40.0;
+const float THRUST_KD = 0.0;
+const float RPM_KP = 0.02;              //us of PWM per RPM of error
+const float RPM_KI = 0.04;
+const float RPM_KD = 0.0;
+const int HOLD_MAX_THROTTLE = 2000;     //output ceiling while holding
+const int SLEW_LIMIT = 10;              //max PWM change per control update (us)
+const float SETTLE_BAND = 0.05;         //fraction of the target the reading must stay within
+const int SETTLE_TIME = 500;            //ms inside the band before the point counts as settled
+
+//PID and settling state, one per ESC channel
+struct HoldChannel {
+  float integral;
+  float prev_error;
+  unsigned long band_entry_timestamp;
+  unsigned long settling_time;
+  bool in_band;
+  bool settled;
+  float error_sum;                      //error accumulated after settling, for the steady-state error
+  int error_samples;
+};
+
+float target;
+float target_step;
+float max_target;
+unsigned long last_control_timestamp;
+HoldChannel hold_channels[ESC_CHANNELS];
+
+
+////////////////////////////////////////////////////////////////////////////////////////
+//TEST QUEUE DEFINITIONS
+//(Parameter sets queued from the keypad or over Serial are kept in EEPROM and run back to back. Test numbers are
+//handed out from next_test_number, which is saved as each run starts so files are never overwritten. Between runs
+//the ESCs sit at minimum for cool_down seconds and the slaves keep their tare instead of re-initializing)
+
+struct TestPlan {
+  long max_value;                       //% throttle, N or RPM, as typed at MAX; RPM targets can pass 32767
+  long increment;
+  int markers;
+  int increment_length;                 //s
+  uint8_t flags;                        //PLAN_SMOOTH | PLAN_RAW
+  uint8_t control_mode;
+};
+
+struct QueueHeader {
+  uint8_t magic;
+  uint8_t count;
+  int next_test_number;
+  int cool_down;                        //s
+};
 
-const int INTERRUPT_PIN = 2;
\ No newline at end of file
+const uint8_t PLAN_SMOOTH = 1;
+const uint8_t PLAN_RAW = 2;
+const uint8_t QUEUE_MAGIC = 0x5B;       //an EEPROM that was never written reads 0xFF; changed with the TestPlan layout
+const int QUEUE_HEADER_ADDRESS = 0;
+const int QUEUE_PLANS_ADDRESS = QUEUE_HEADER_ADDRESS + sizeof(QueueHeader);
+const int QUEUE_CAPACITY = 32;
+const int DEFAULT_COOL_DOWN = 60;
+
+QueueHeader queue;
+int queue_index;                        //next plan to run
+bool queue_running;
+bool cooling_down;
+unsigned long cool_down_timestamp;
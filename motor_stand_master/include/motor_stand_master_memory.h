@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////////////
+//STACK HIGH-WATERMARK
+//(All RAM between the end of .bss and the top of the stack is painted before main() runs. The stack only ever
+//overwrites the paint, so where the paint starts below it marks the deepest the stack has been, ISRs nested on top
+//of everything else included. The static side (.data, .bss, flash) is checked at build time by
+//"pio run -t memory_report", see tools/memory_report.py)
+
+const uint8_t STACK_PAINT = 0xC5;
+const uint8_t STACK_PAINT_RUN = 64;     //painted bytes in a row that mark the end of the stack
+
+extern uint8_t _end;
+extern uint8_t __stack;
+extern uint8_t __data_start;
+extern int __heap_start;
+extern int *__brkval;
+
+void paint_stack() __attribute__ ((naked, used, section (".init1")));
+void paint_stack(){
+  uint8_t *p = &_end;
+  while(p <= &__stack){
+    *p = STACK_PAINT;
+    p++;
+  }
+}
+
+//Lowest stack address that was ever written, found by scanning down from the top of RAM to the first run of
+//STACK_PAINT_RUN painted bytes. Scanning up from the heap instead would count heap blocks that were used and freed
+//(which lowers __brkval again) as stack. The run is longer than any local buffer on either board (the largest is
+//Print::printNumber's 33 byte buf, mostly never written, just above the SD write frames), so an unused part of
+//one can't end the scan early. The figure can only read high once fewer than 64 bytes were ever left free
+uint8_t* stack_low_watermark(){
+  uint8_t *p = &__stack;
+  uint8_t painted = 0;
+  while(p >= &_end && painted < STACK_PAINT_RUN){
+    painted = *p == STACK_PAINT ? painted + 1 : 0;
+    p--;
+  }
+  return p + painted + 1;
+}
+
+unsigned int measure_peak_stack(){
+  return &__stack - stack_low_watermark() + 1;
+}
+
+unsigned int static_ram(){
+  return &_end - &__data_start;
+}
+
+//Current gap between the heap and the stack
+int free_memory(){
+  int v;
+  return (int)&v - (__brkval == 0 ? (int)&__heap_start : (int)__brkval);
+}
+
+void print_memory(Print& out){
+  out.print(F("STATIC RAM: ")); out.print(static_ram());
+  out.print(F(" | PEAK STACK: ")); out.print(measure_peak_stack());
+  out.print(F(" | FREE: ")); out.println(free_memory());
+}
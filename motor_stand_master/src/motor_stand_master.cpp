@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include <motor_stand_master_definitions.h>
+#include <motor_stand_master_memory.h>
+#include <motor_stand_master_benchmark.h>
 
 ////////////////////////////////////////////////////////////////////////////////////////
 //HELPER FUNCTIONS:
@@ -41,20 +43,210 @@ void send_ui(){
     lcd.print("ANALOG SENSORS");
   }
   if(tare_index != 2){
+    lcd.setCursor(0, 1);
+    lcd.print("LOAD SLAVE " + String(slave_addresses[tare_slave]) + " (" + String(tare_slave + 1) + "/" + String(slave_count) + ")");
     lcd.setCursor(0, 3);
     lcd.print("BACK: " + String(BACK_BUTTON));
   }
   lcd.setCursor(0, 1);
 }
 
+//Run events and parameters go to every slave at once (I2C general call)
 void send_parameters(String type, String value){
   String signal = type + value;
   int length = signal.length();
-  Wire.beginTransmission(9);
+  Wire.beginTransmission(BROADCAST_ADDRESS);
   Wire.write(signal.c_str(), length);
   Wire.endTransmission();
 }
 
+void send_command(char type){
+  Wire.beginTransmission(BROADCAST_ADDRESS);
+  Wire.write(type);
+  Wire.endTransmission();
+}
+
+void send_to_slave(int address, String type, String value){
+  String signal = type + value;
+  Wire.beginTransmission(address);
+  Wire.write(signal.c_str(), signal.length());
+  Wire.endTransmission();
+}
+
+//Blocks until the slave reports that it is initialized/done calibrating
+void wait_for_slave(int address){
+  while(1){
+    Wire.requestFrom(address, 1);
+    if(Wire.read() == 1){
+      break;
+    }
+    delay(100);
+  }
+}
+
+void wait_for_slaves(){
+  for(int i = 0; i < slave_count; i++){
+    wait_for_slave(slave_addresses[i]);
+  }
+}
+
+//Known load calibration goes to one stand at a time, since the load has to be moved between them
+void tare_next_slave(String type){
+  Serial.println("TARING SLAVE " + String(slave_addresses[tare_slave]));
+  send_to_slave(slave_addresses[tare_slave], type, tare_values[tare_index]);
+  wait_for_slave(slave_addresses[tare_slave]);
+  tare_slave++;
+}
+
+//Probes every slave address until the same non-zero set answers twice in a row, so slaves still booting aren't missed
+void discover_slaves(){
+  int previous_count = -1;
+  while(1){
+    slave_count = 0;
+    for(int i = 0; i < MAX_SLAVES; i++){
+      Wire.beginTransmission(SLAVE_ADDRESS_FIRST + i);
+      if(Wire.endTransmission() == 0){
+        slave_addresses[slave_count++] = SLAVE_ADDRESS_FIRST + i;
+      }
+    }
+    if(slave_count > 0 && slave_count == previous_count){
+      break;
+    }
+    previous_count = slave_count;
+    delay(500);
+  }
+  esc_count = min(slave_count, ESC_CHANNELS);
+  Serial.println("SLAVES FOUND: " + String(slave_count));
+}
+
+ISR(TIMER1_OVF_vect){
+  for(int ch = 0; ch < ESC_CHANNELS; ch++){
+    *esc_port[ch] |= esc_mask[ch];
+  }
+}
+
+ISR(TIMER1_COMPA_vect){
+  *esc_port[0] &= ~esc_mask[0];
+}
+
+ISR(TIMER1_COMPB_vect){
+  *esc_port[1] &= ~esc_mask[1];
+}
+
+//All throttle changes go through here so nothing can raise the throttle again after an e-stop
+void esc_write(int channel, int cycle){
+  cycle = constrain(cycle, MIN_THROTTLE, 2000);
+  noInterrupts(); //the e-stop ISR can't land between the check and the write, or share the 16 bit TEMP register with it
+  if(!esc_killed){
+    if(channel == 0){
+      OCR1A = cycle * 2; //buffered until the next period starts
+    }
+    else{
+      OCR1B = cycle * 2;
+    }
+    esc_cycle[channel] = cycle;
+  }
+  interrupts();
+}
+
+void esc_write_all(int cycle){
+  for(int ch = 0; ch < ESC_CHANNELS; ch++){
+    esc_write(ch, cycle);
+  }
+}
+
+//The e-stop line is held low while the switch is down or the slave's KILL_PIN is pulling it
+bool estop_engaged(){
+  return digitalRead(INTERRUPT_PIN) == LOW;
+}
+
+//Clears the e-stop latch only once the line reads high again; a held switch keeps the ESCs at minimum
+bool esc_rearm(){
+  noInterrupts();
+  esc_killed = estop_engaged();
+  interrupts();
+  return !esc_killed;
+}
+
+//Starts the ESC pulse trains at minimum throttle; only the first call configures Timer1 so setup() can be rerun
+void esc_begin(){
+  if(!esc_running){
+    for(int ch = 0; ch < ESC_CHANNELS; ch++){
+      pinMode(ESC_PINS[ch], OUTPUT);
+      digitalWrite(ESC_PINS[ch], LOW);
+      esc_port[ch] = portOutputRegister(digitalPinToPort(ESC_PINS[ch]));
+      esc_mask[ch] = digitalPinToBitMask(ESC_PINS[ch]);
+    }
+
+    noInterrupts();
+    TCCR1A = _BV(WGM11); //fast PWM with TOP = ICR1 (mode 14), hardware output pins disconnected
+    TCCR1B = _BV(WGM13) | _BV(WGM12) | _BV(CS11);
+    ICR1 = ESC_PERIOD_TICKS - 1;
+    OCR1A = MIN_THROTTLE * 2;
+    OCR1B = MIN_THROTTLE * 2;
+    TCNT1 = 0;
+    TIMSK1 = _BV(TOIE1) | _BV(OCIE1A) | _BV(OCIE1B);
+    interrupts();
+    esc_running = true;
+  }
+  esc_killed = false;
+  esc_write_all(MIN_THROTTLE);
+  esc_rearm();
+}
+
+void show_estop_engaged(){
+  lcd.clear();
+  lcd.print("E-STOP ENGAGED");
+  lcd.setCursor(0, 1);
+  lcd.print("RELEASE E-STOP");
+  lcd.setCursor(0, 3);
+  lcd.print("THEN START AGAIN");
+  Serial.println("E-STOP ENGAGED: RELEASE IT TO START");
+}
+
+//Reads a slave's status reply: the ready byte followed by the live thrust and RPM, then its peak stack depth
+bool read_slave_status(int address, float& thrust, float& rpm, uint16_t& slave_peak_stack){
+  if(Wire.requestFrom(address, STATUS_LENGTH) != STATUS_LENGTH){
+    return false;
+  }
+  uint8_t status[STATUS_LENGTH];
+  for(unsigned int i = 0; i < sizeof(status); i++){
+    status[i] = Wire.read();
+  }
+  memcpy(&thrust, status + 1, sizeof(float));
+  memcpy(&rpm, status + 1 + sizeof(float), sizeof(float));
+  memcpy(&slave_peak_stack, status + 1 + 2 * sizeof(float), sizeof(uint16_t));
+  return true;
+}
+
+bool read_live_readings(int address, float& thrust, float& rpm){
+  uint16_t slave_peak_stack;
+  return read_slave_status(address, thrust, rpm, slave_peak_stack);
+}
+
+//Static RAM, peak stack and free RAM of the master, then the peak stack each slave reports
+void print_memory_report(){
+  Serial.print(F("MASTER | "));
+  print_memory(Serial);
+  for(int i = 0; i < slave_count; i++){
+    float thrust, rpm;
+    uint16_t slave_peak_stack;
+    if(read_slave_status(slave_addresses[i], thrust, rpm, slave_peak_stack)){
+      Serial.println("SLAVE " + String(slave_addresses[i]) + " | PEAK STACK: " + String(slave_peak_stack));
+    }
+  }
+}
+
+//Merged index of the run: which slave logged which file against which ESC, all timed from the same broadcast start
+void print_run_index(){
+  Serial.println("RUN INDEX: TEST, SLAVE, ESC PIN, FILE, START (ms)");
+  for(int i = 0; i < slave_count; i++){
+    Serial.println(parameter_values[0] + ", " + String(slave_addresses[i]) + ", "
+                   + (i < esc_count ? String(ESC_PINS[i]) : String("-")) + ", TEST_" + parameter_values[0] + ".csv, "
+                   + String(run_start_timestamp));
+  }
+}
+
 void start_testing(){
   lcd.clear();
   lcd.print("RUNNING TEST");
@@ -66,16 +258,34 @@ void start_testing(){
   lcd.print("THROTTLE:0");
   Serial.println("Starting: Test Num: " + parameter_values[0] + " | Increment: " + String(throttleIncrement));
   start_motor = true;
-  Wire.beginTransmission(9);
-  Wire.write('b');
-  Wire.endTransmission();
+  send_command('b');
+  run_start_timestamp = millis();
+  print_run_index();
   prev_interval_timestamp = millis();
 }
 
+//Between queued runs the slaves close their file but keep their tare, and the ESCs idle for the cool-down;
+//an e-stop or the last plan ends the queue with the usual full reset
 void end_testing(){
-  Wire.beginTransmission(9);
-  Wire.write('e');
-  Wire.endTransmission();
+  print_memory_report();
+  if(queue_running && queue_index < queue.count && !esc_killed){
+    send_parameters("e", "1");
+    start_motor = false;
+    done_throttling = false;
+    cooling_down = true;
+    cool_down_timestamp = millis();
+    Serial.println("COOLING DOWN: " + String(queue.cool_down) + " s");
+    lcd.clear();
+    lcd.setCursor(0, 0);
+    lcd.print("COOLING DOWN");
+    lcd.setCursor(0, 1);
+    lcd.print("NEXT: " + String(queue_index + 1) + " OF " + String(queue.count));
+    lcd.setCursor(0, 3);
+    lcd.print("THROTTLE:0");
+    return;
+  }
+  queue_running = false;
+  send_command('e');
   setup();
 }
 
@@ -88,40 +298,51 @@ void throttle_up(){
   }
   else{
     if(millis() >= prev_interval_timestamp + INCREMENT_TIME){
+      int next_cycle_length = min(cycle_length + pwm_increment, MAX_THROTTLE);
       if(!read_gradient){
-        Wire.beginTransmission(9);
-        Wire.write('w');
-        Wire.endTransmission();
+        send_command('w');
       }
-      int next_cycle_length = min(cycle_length + pwm_increment, MAX_THROTTLE);
       for(; cycle_length <= next_cycle_length; cycle_length++){
         if(done_throttling){
           return; //return to the main loop and throttle down
         }
-        esc.writeMicroseconds(cycle_length);
+        esc_write_all(cycle_length);
         lcd.setCursor(9, 3);
         lcd.print(String(map(cycle_length, 1000, 2000, 0, 100)));
         delay(THROTTLE_UP_DELAY);
       }
       cycle_length--;
+      //burst capture trigger, sent once the ramp has reached the step: the pre-trigger samples cover the end of
+      //the ramp and the rest of the window the settling, where a trigger at the start would spend it on the ramp
+      send_parameters("t", String(next_cycle_length));
       if(!read_gradient){
-        Wire.beginTransmission(9);
-        Wire.write('g');
-        Wire.endTransmission();
+        send_command('g');
       }
       prev_interval_timestamp = millis();
     }
   }
 }
 
+//Ramps every ESC output down together, including one without a slave of its own (open loop drives both outputs,
+//e.g. a coaxial pair on one stand); a channel held lower than the ramp position keeps its own value
 void throttle_down(){
   if(!read_gradient){
-    Wire.beginTransmission(9);
-    Wire.write('w');
-    Wire.endTransmission();
+    send_command('w');
+  }
+  int highest_cycle = MIN_THROTTLE;
+  for(int ch = 0; ch < ESC_CHANNELS; ch++){
+    highest_cycle = max(highest_cycle, esc_cycle[ch]);
   }
-  for(int i = cycle_length; i >= MIN_THROTTLE; i--){
-    esc.writeMicroseconds(i);
+  if(esc_killed){ //already at minimum, skip the ramp
+    Serial.println("E-STOP");
+    lcd.setCursor(9, 3);
+    lcd.print("0 E-STOP");
+    highest_cycle = MIN_THROTTLE;
+  }
+  for(int i = highest_cycle; i >= MIN_THROTTLE && !esc_killed; i--){
+    for(int ch = 0; ch < ESC_CHANNELS; ch++){
+      esc_write(ch, min(esc_cycle[ch], i));
+    }
     int throttle = map(i, 1000, 2000, 0, 100);
     if(throttle == 99){
       lcd.setCursor(11, 3);
@@ -135,16 +356,141 @@ void throttle_down(){
     lcd.print(String(throttle));
     delay(THROTTLE_UP_DELAY);
   }
+  cycle_length = MIN_THROTTLE;
+  send_parameters("t", String(MIN_THROTTLE)); //burst capture trigger, at the end of the ramp as in throttle_up()
   delay(INCREMENT_TIME);
   end_testing();
 }
 
+//One fixed-rate PID update; the integral only grows while the output is not saturated in the same direction
+void control_step(int channel, float measured){
+  HoldChannel& hold = hold_channels[channel];
+  float kp = control_mode == HOLD_THRUST ? THRUST_KP : RPM_KP;
+  float ki = control_mode == HOLD_THRUST ? THRUST_KI : RPM_KI;
+  float kd = control_mode == HOLD_THRUST ? THRUST_KD : RPM_KD;
+  const float dt = CONTROL_INTERVAL / 1000.0;
+
+  float error = target - measured;
+  float derivative = (error - hold.prev_error) / dt;
+  hold.prev_error = error;
+
+  float output = MIN_THROTTLE + kp * error + ki * hold.integral + kd * derivative;
+  int written = constrain((int)constrain(output, MIN_THROTTLE, HOLD_MAX_THROTTLE), esc_cycle[channel] - SLEW_LIMIT, esc_cycle[channel] + SLEW_LIMIT);
+  //the slew limit clips far more often than the throttle range, so both count as saturation; while clipped the
+  //integral only moves in the direction that brings the output back to what is actually written
+  float clipped = written - output;
+  if(fabs(clipped) < 1 || (clipped > 0) == (error > 0)){
+    hold.integral += error * dt;
+  }
+  esc_write(channel, written);
+
+  //settling: the first time the reading stays within the band for SETTLE_TIME
+  if(abs(error) <= SETTLE_BAND * target){
+    if(!hold.in_band){
+      hold.in_band = true;
+      hold.band_entry_timestamp = millis();
+    }
+    if(!hold.settled && millis() >= hold.band_entry_timestamp + SETTLE_TIME){
+      hold.settled = true;
+      hold.settling_time = hold.band_entry_timestamp - prev_interval_timestamp;
+    }
+  }
+  else{
+    hold.in_band = false;
+  }
+  if(hold.settled){
+    hold.error_sum += error;
+    hold.error_samples++;
+  }
+}
+
+//Logs the settling time (-1 if it never settled) and mean error after settling for the target just finished,
+//to Serial and to the channel's own slave
+void report_hold(int channel){
+  const HoldChannel& hold = hold_channels[channel];
+  long settle = hold.settled ? (long)hold.settling_time : -1;
+  float steady_state_error = hold.error_samples > 0 ? hold.error_sum / hold.error_samples : 0;
+  Serial.println("HOLD: " + String(target) + " | SLAVE: " + String(slave_addresses[channel]) + " | SETTLING (ms): " + String(settle) + " | SS ERROR: " + String(steady_state_error));
+  send_to_slave(slave_addresses[channel], "h", String(target) + ", " + String(settle) + ", " + String(steady_state_error));
+}
+
+void reset_hold(){
+  for(int ch = 0; ch < ESC_CHANNELS; ch++){
+    hold_channels[ch].integral = 0;
+    hold_channels[ch].prev_error = 0;
+  }
+}
+
+void next_target(){
+  target = min(target + target_step, max_target);
+  send_parameters("t", String((long)target)); //burst capture trigger
+  prev_interval_timestamp = millis();
+  for(int ch = 0; ch < esc_count; ch++){
+    hold_channels[ch].in_band = false;
+    hold_channels[ch].settled = false;
+    hold_channels[ch].error_sum = 0;
+    hold_channels[ch].error_samples = 0;
+  }
+  lcd.setCursor(0, 2);
+  lcd.print("TARGET: " + String((long)target) + (control_mode == HOLD_THRUST ? " N     " : " RPM   "));
+}
+
+//Closed-loop counterpart of throttle_up(); prev_interval_timestamp marks when the current target was set.
+//Every channel with an ESC runs its own PID on its own slave's readings
+void hold_setpoints(){
+  if(millis() >= prev_interval_timestamp + INCREMENT_TIME){
+    if(target > 0){
+      for(int ch = 0; ch < esc_count; ch++){
+        report_hold(ch);
+      }
+    }
+    if(target >= max_target){
+      Serial.println("DONE HOLDING");
+      done_throttling = true;
+      return;
+    }
+    next_target();
+  }
+
+  if(target > 0 && millis() >= last_control_timestamp + CONTROL_INTERVAL){
+    last_control_timestamp = millis();
+    for(int ch = 0; ch < esc_count; ch++){
+      float thrust, rpm;
+      if(read_live_readings(slave_addresses[ch], thrust, rpm)){
+        control_step(ch, control_mode == HOLD_THRUST ? thrust : rpm);
+      }
+    }
+  }
+}
+
+//E-stop: minimum goes straight into the timer for the next period. If a pulse is already past the minimum
+//width it is cut here too, so no ESC sees more than one more long pulse
 void interrupt(){
+  OCR1A = MIN_THROTTLE * 2;
+  OCR1B = MIN_THROTTLE * 2;
+  if(esc_running && TCNT1 >= MIN_THROTTLE * 2){
+    for(int ch = 0; ch < ESC_CHANNELS; ch++){
+      *esc_port[ch] &= ~esc_mask[ch];
+    }
+  }
+  esc_killed = true;
   if(start_motor){
     done_throttling = true;
   }
 }
 
+void start_prompt(){
+  lcd.clear();
+  lcd.setCursor(0, 0);
+  lcd.print("PRESS " + String(SEND_INPUT) + " TO START");
+  lcd.setCursor(0, 1);
+  lcd.print("A: ADD TO QUEUE");
+  lcd.setCursor(0, 2);
+  lcd.print("B: RUN QUEUE (" + String(queue.count) + ")");
+  lcd.setCursor(0, 3);
+  lcd.print("C: CLEAR QUEUE");
+}
+
 void setup_next_input(){
   if(parameter_index < PARAMETER_NUM){
     parameter_values[parameter_index] = input;
@@ -160,7 +506,19 @@ void setup_next_input(){
   else if(parameter_index == PARAMETER_NUM + 1){
     lcd.clear();
     lcd.setCursor(0, 0);
-    lcd.print("PRESS " + String(SEND_INPUT) + " TO START");
+    lcd.print("RAW CAPTURE?");
+    lcd.setCursor(0, 3);
+    lcd.print("YES: A | NO: B");
+  }
+  else if(parameter_index == PARAMETER_NUM + 2){
+    lcd.clear();
+    lcd.setCursor(0, 0);
+    lcd.print("CONTROL MODE?");
+    lcd.setCursor(0, 3);
+    lcd.print("A:OPEN B:THR C:RPM");
+  }
+  else if(parameter_index == PARAMETER_NUM + 3){
+    start_prompt();
   }
   else{
     lcd_home();
@@ -173,16 +531,32 @@ void setup_prev_input(){
 }
 
 void send_inputs(){
+  if(!esc_rearm()){ //a held e-stop refuses the run; '*' tries again once it is released
+    show_estop_engaged();
+    return;
+  }
+  //markers and capture mode go first so the slave can snapshot them into the file header
+  send_parameters("x", raw_capture ? "1" : "0");
+  send_parameters("m", parameter_values[3]);
+  delay(100);
   send_parameters("f", parameter_values[0]);
   delay(100);
 
-  int max_throttle_input = min(max(parameter_values[1].toInt(), 0), 100);
-  MAX_THROTTLE = map(max_throttle_input, 0, 100, 1000, 2000);
+  if(control_mode == OPEN_LOOP){
+    int max_throttle_input = min(max(parameter_values[1].toInt(), 0), 100);
+    MAX_THROTTLE = map(max_throttle_input, 0, 100, 1000, 2000);
 
-  throttleIncrement = min(parameter_values[2].toInt(), max_throttle_input);
-  pwm_increment = map(throttleIncrement, 0, 100, 0, 1000); //1% -> 99% written in terms of PWM cycle length, assuming a linear mapping
-  
-  send_parameters("m", parameter_values[3]);
+    throttleIncrement = min(parameter_values[2].toInt(), max_throttle_input);
+    pwm_increment = map(throttleIncrement, 0, 100, 0, 1000); //1% -> 99% written in terms of PWM cycle length, assuming a linear mapping
+  }
+  else{
+    max_target = parameter_values[1].toInt();
+    target_step = min(parameter_values[2].toInt(), max_target);
+    throttleIncrement = target_step;
+    target = 0;
+    reset_hold();
+    last_control_timestamp = 0;
+  }
 
   INCREMENT_TIME = parameter_values[4].toInt() * 1000;
   Serial.println("TEST PARAMETERS CONFIRMED");
@@ -190,10 +564,253 @@ void send_inputs(){
   start_testing();
 }
 
+////////////////////////////////////////////////////////////////////////////////////////
+//TEST QUEUE:
+
+void save_queue_header(){
+  EEPROM.put(QUEUE_HEADER_ADDRESS, queue); //put() only rewrites the bytes that changed
+}
+
+void load_queue(){
+  EEPROM.get(QUEUE_HEADER_ADDRESS, queue);
+  if(queue.magic != QUEUE_MAGIC || queue.count > QUEUE_CAPACITY){
+    queue.magic = QUEUE_MAGIC;
+    queue.count = 0;
+    queue.next_test_number = 1;
+    queue.cool_down = DEFAULT_COOL_DOWN;
+    save_queue_header();
+  }
+}
+
+bool queue_add(const TestPlan& plan){
+  if(queue.count >= QUEUE_CAPACITY){
+    Serial.println("QUEUE FULL");
+    return false;
+  }
+  EEPROM.put(QUEUE_PLANS_ADDRESS + queue.count * sizeof(TestPlan), plan);
+  queue.count++;
+  save_queue_header();
+  Serial.println("QUEUED: " + String(queue.count));
+  return true;
+}
+
+void clear_queue(){
+  queue.count = 0;
+  save_queue_header();
+  Serial.println("QUEUE CLEARED");
+}
+
+TestPlan read_plan(int index){
+  TestPlan plan;
+  EEPROM.get(QUEUE_PLANS_ADDRESS + index * sizeof(TestPlan), plan);
+  return plan;
+}
+
+//The parameters as entered on the keypad; TEST # is left out since queued runs are numbered automatically
+TestPlan plan_from_parameters(){
+  TestPlan plan;
+  plan.max_value = parameter_values[1].toInt();
+  plan.increment = parameter_values[2].toInt();
+  plan.markers = parameter_values[3].toInt();
+  plan.increment_length = parameter_values[4].toInt();
+  plan.flags = (read_gradient ? PLAN_SMOOTH : 0) | (raw_capture ? PLAN_RAW : 0);
+  plan.control_mode = control_mode;
+  return plan;
+}
+
+//Loads the next plan into the parameters as if it had been typed in, gives it the next test number and starts it
+void start_next_plan(){
+  if(estop_engaged()){ //stops the queue before it uses up a test number
+    queue_running = false;
+    show_estop_engaged();
+    return;
+  }
+  if(queue.next_test_number > MAX_TEST_NUMBER){
+    queue_running = false;
+    Serial.println("OUT OF TEST NUMBERS: SET QUEUE NUMBER");
+    return;
+  }
+  TestPlan plan = read_plan(queue_index);
+  queue_index++;
+  parameter_values[0] = String(queue.next_test_number);
+  queue.next_test_number++;
+  save_queue_header(); //saved before the run so a reset can't reuse the number
+  parameter_values[1] = String(plan.max_value);
+  parameter_values[2] = String(plan.increment);
+  parameter_values[3] = String(plan.markers);
+  parameter_values[4] = String(plan.increment_length);
+  read_gradient = plan.flags & PLAN_SMOOTH;
+  raw_capture = plan.flags & PLAN_RAW;
+  control_mode = (ControlMode)plan.control_mode;
+  Serial.println("QUEUE: RUN " + String(queue_index) + " OF " + String(queue.count));
+  send_inputs();
+}
+
+void run_queue(){
+  if(queue.count == 0){
+    Serial.println("QUEUE EMPTY");
+    return;
+  }
+  queue_index = 0;
+  queue_running = true;
+  start_next_plan();
+}
+
+void print_queue(){
+  Serial.println("QUEUE: " + String(queue.count) + " | NEXT TEST #: " + String(queue.next_test_number) + " | COOL DOWN (s): " + String(queue.cool_down));
+  Serial.println("#, MAX, INCR, MARKERS, INCR. LENGTH (s), SMOOTH, RAW, MODE");
+  for(int i = 0; i < queue.count; i++){
+    TestPlan plan = read_plan(i);
+    Serial.println(String(i + 1) + ", " + String(plan.max_value) + ", " + String(plan.increment) + ", " + String(plan.markers) + ", "
+                   + String(plan.increment_length) + ", " + String((plan.flags & PLAN_SMOOTH) ? 1 : 0) + ", "
+                   + String((plan.flags & PLAN_RAW) ? 1 : 0) + ", " + String(plan.control_mode));
+  }
+}
+
+//Returns the number before the first comma and removes it from fields
+long take_field(String& fields){
+  int comma = fields.indexOf(',');
+  long value = fields.substring(0, comma < 0 ? fields.length() : comma).toInt();
+  fields = comma < 0 ? String("") : fields.substring(comma + 1);
+  return value;
+}
+
+//Serial commands, one per line, accepted while no test is running:
+//  QUEUE ADD max,incr,markers,incr_length,smooth,raw,mode   (smooth/raw: 0 or 1, mode: 0 open loop, 1 thrust, 2 RPM)
+//  QUEUE LIST | QUEUE CLEAR | QUEUE RUN | QUEUE NUMBER n | COOLDOWN s | MEMORY
+void handle_serial_command(){
+  String line = Serial.readStringUntil('\n');
+  line.trim();
+  line.toUpperCase();
+  if(line.startsWith("QUEUE ADD ")){
+    String fields = line.substring(10);
+    TestPlan plan;
+    plan.max_value = take_field(fields);
+    plan.increment = take_field(fields);
+    plan.markers = take_field(fields);
+    plan.increment_length = take_field(fields);
+    plan.flags = take_field(fields) ? PLAN_SMOOTH : 0;
+    plan.flags |= take_field(fields) ? PLAN_RAW : 0;
+    long mode = take_field(fields); //constrain() is a macro and would take the field up to three times
+    plan.control_mode = constrain(mode, OPEN_LOOP, HOLD_RPM);
+    queue_add(plan);
+  }
+  else if(line == "QUEUE LIST"){
+    print_queue();
+  }
+  else if(line == "QUEUE CLEAR"){
+    clear_queue();
+  }
+  else if(line == "QUEUE RUN"){
+    if(tared){
+      run_queue();
+    }
+    else{
+      Serial.println("TARE FIRST");
+    }
+  }
+  else if(line.startsWith("QUEUE NUMBER ")){
+    long number = line.substring(13).toInt();
+    queue.next_test_number = constrain(number, 0, MAX_TEST_NUMBER);
+    save_queue_header();
+    print_queue();
+  }
+  else if(line.startsWith("COOLDOWN ")){
+    queue.cool_down = max(line.substring(9).toInt(), 0);
+    save_queue_header();
+    print_queue();
+  }
+  else if(line == "MEMORY"){
+    print_memory_report();
+  }
+  else if(line != ""){
+    Serial.println("UNKNOWN COMMAND: " + line);
+  }
+}
+
+#ifdef BENCHMARK
+////////////////////////////////////////////////////////////////////////////////////////
+//BENCHMARKS (the LCD and the slave are not simulated; their output goes to a NullPrint)
+
+//One microsecond of a throttle_up() ramp, minus the LCD transfer and the THROTTLE_UP_DELAY
+void bench_ramp_step(Print& out, int cycle){
+  esc_write_all(cycle);
+  out.print(String(map(cycle, 1000, 2000, 0, 100)));
+}
+
+//Cycles from INTERRUPT_PIN falling to the ESC being latched at minimum (trip) and to the first ESC pin reading
+//low (output). An external interrupt pin still fires when it is an output, so driving it low from here stands in
+//for the e-stop switch or the slave's KILL_PIN. The edge lands offset_us after a pulse starts
+void bench_estop_trip(unsigned int offset_us, unsigned long& trip, unsigned long& output){
+  esc_killed = false;
+  pinMode(INTERRUPT_PIN, OUTPUT);
+  digitalWrite(INTERRUPT_PIN, HIGH);
+  EIFR = bit(INTF0); //drop any edge latched while the interrupt was detached
+  attachInterrupt(digitalPinToInterrupt(INTERRUPT_PIN), interrupt, FALLING);
+  while(*esc_port[0] & esc_mask[0]);
+  while(!(*esc_port[0] & esc_mask[0])); //start of the next pulse
+  delayMicroseconds(offset_us);
+  unsigned long start = bench_ticks();
+  digitalWrite(INTERRUPT_PIN, LOW);
+  while(!esc_killed);
+  trip = (bench_ticks() - start) * 8;
+  while(*esc_port[0] & esc_mask[0]); //a pulse already running can finish at its old width
+  output = (bench_ticks() - start) * 8;
+  detachInterrupt(digitalPinToInterrupt(INTERRUPT_PIN));
+  esc_killed = false;
+}
+
+void run_benchmarks(){
+  Serial.begin(9600);
+  bench_begin();
+  NullPrint sink;
+  pinMode(INTERRUPT_PIN, INPUT_PULLUP);
+  esc_begin();
+  esc_killed = false; //no e-stop is wired under the simulator, whatever the floating line reads
+
+  parameter_values[0] = "12";
+  parameter_values[1] = "80";
+  parameter_values[2] = "10";
+  parameter_values[3] = "2";
+  parameter_values[4] = "5";
+
+  int n = 0;
+  BENCH("throttle_map", bench_sink = map(MIN_THROTTLE + (n++ & 1023), 1000, 2000, 0, 100));
+  BENCH("esc_write", esc_write(0, MIN_THROTTLE + (n++ & 1023)));
+  BENCH("setpoint_message", bench_sink = (String("t") + String(MIN_THROTTLE + (n++ & 1023))).length());
+  BENCH("ramp_step", bench_ramp_step(sink, MIN_THROTTLE + (n++ & 1023)));
+  BENCH("parse_parameters", bench_sink = map(min(max(parameter_values[1].toInt(), 0), 100), 0, 100, 1000, 2000) + parameter_values[4].toInt() * 1000);
+  control_mode = HOLD_THRUST;
+  target = 10;
+  reset_hold();
+  BENCH("pid_step", control_step(0, 9.5 + (n++ & 7) * 0.125));
+  BENCH("log_status_line", sink.println("Starting: Test Num: " + parameter_values[0] + " | Increment: " + String(throttleIncrement)));
+
+  unsigned long worst_trip = 0;
+  unsigned long worst_output = 0;
+  for(int i = 0; i < BENCH_ITERATIONS; i++){
+    unsigned long trip, output;
+    esc_write_all(2000); //full throttle is the longest pulse the trip can land in
+    bench_estop_trip(i * 70, trip, output); //steps the edge across the 2 ms pulse and a little past it
+    worst_trip = max(worst_trip, trip);
+    worst_output = max(worst_output, output);
+  }
+  bench_report(F("estop_trip"), worst_trip);
+  bench_report(F("estop_output_low"), worst_output);
+
+  esc_write_all(MIN_THROTTLE);
+  bench_memory_report();
+  bench_end();
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////////////
 //MAIN DRIVER CODE:
 
 void setup() {
+#ifdef BENCHMARK
+  run_benchmarks(); //never returns
+#endif
   pinMode(INTERRUPT_PIN, INPUT_PULLUP); //set default switch position to HIGH
   attachInterrupt(digitalPinToInterrupt(INTERRUPT_PIN), interrupt, FALLING); //when switch is pressed down
 
@@ -207,6 +824,8 @@ void setup() {
   throttling_up = false;
   start_motor = false;
   cycle_length = MIN_THROTTLE;
+  queue_running = false;
+  cooling_down = false;
   
   // Set up the LCD display
   lcd.init();
@@ -219,17 +838,12 @@ void setup() {
   //Initialize I2C protocol (master)
   Wire.begin();
 
-  //Initialize servo PWM and arm the ESC
-  esc.attach(ESC_PIN); //set esc to pin
-  esc.writeMicroseconds(MIN_THROTTLE); //minimum throttle; arm the esc
+  //Start the ESC pulse trains and arm the ESCs
+  esc_begin(); //minimum throttle; arm the esc
 
-  while(1){
-    Wire.requestFrom(9, 1);
-    if(Wire.read() == 1){
-      break;
-    }
-    delay(100);
-  }
+  discover_slaves();
+  wait_for_slaves();
+  load_queue();
 
   lcd.setCursor(0, 0);
   lcd.print("USE PREVIOUS TARE?");
@@ -243,6 +857,10 @@ void setup() {
 
 void loop() {
   char key = keypad.getKey();
+
+  if(!start_motor && !cooling_down && Serial.available()){
+    handle_serial_command();
+  }
   
   if(!tared){
     if(key){
@@ -266,43 +884,33 @@ void loop() {
           }
           else if(key == SEND_INPUT){ //the button to zero the values
             lcd.setCursor(0, 1);
-            lcd.print("CALIBRATING...");
+            lcd.print("CALIBRATING...      "); //clears the LOAD SLAVE line
             if(tare_index == 0){
-              send_parameters("q", tare_values[tare_index]); //tell slave to tare torque
-              while(1){
-                Wire.requestFrom(9, 1);
-                if(Wire.read() == 1){
-                  break;
-                }
-                delay(100);
+              tare_next_slave("q"); //tell the loaded slave to tare torque
+              if(tare_slave < slave_count){
+                send_ui(); //same known torque on the next stand
+              }
+              else{
+                tare_slave = 0;
+                tare_index++;
+                tare_ui();
+                sending = false;
               }
-              tare_index++;
-              tare_ui();
-              sending = false;
             }
             else if(tare_index == 1){
-              send_parameters("r", tare_values[tare_index]); //tell slave to tare thrust
-              while(1){
-                Wire.requestFrom(9, 1);
-                if(Wire.read() == 1){
-                  break;
-                }
-                delay(100);
+              tare_next_slave("r"); //tell the loaded slave to tare thrust
+              if(tare_slave < slave_count){
+                send_ui();
               }
-              tare_index++;
-              send_ui();
-            }
-            else if(tare_index == 2){ //tell slave to tare analog sensors
-              Wire.beginTransmission(9);
-              Wire.write('a');
-              Wire.endTransmission();
-              while(1){
-                Wire.requestFrom(9, 1);
-                if(Wire.read() == 1){
-                  break;
-                }
-                delay(100);
+              else{
+                tare_slave = 0;
+                tare_index++;
+                send_ui();
               }
+            }
+            else if(tare_index == 2){ //tell slaves to tare analog sensors
+              send_command('a');
+              wait_for_slaves();
               lcd_home();
               tared = true;
               sending = false;
@@ -312,9 +920,7 @@ void loop() {
       }
       else{
         if(key == 'A'){
-          Wire.beginTransmission(9);
-          Wire.write('p');
-          Wire.endTransmission();
+          send_command('p');
           delay(100);
           choosing = false;
           tared = true;
@@ -323,6 +929,7 @@ void loop() {
         }
         else if(key == 'B'){
           tare_index = 0;
+          tare_slave = 0;
           sending = false;
           choosing = false;
           tare_ui();
@@ -332,7 +939,12 @@ void loop() {
   }
   else{ //can only do everything else once sensors have been tared
     if(start_motor){
-      throttle_up();
+      if(control_mode == OPEN_LOOP){
+        throttle_up();
+      }
+      else{
+        hold_setpoints();
+      }
     }
 
     if(done_throttling){
@@ -340,8 +952,21 @@ void loop() {
       throttle_down();
     }
 
-    //if a keystroke has been entered from the keypad
-    if(key){
+    if(cooling_down){
+      if(esc_killed){ //an e-stop during the cool-down drops the rest of the queue
+        Serial.println("QUEUE STOPPED");
+        setup();
+      }
+      else if(millis() >= cool_down_timestamp + queue.cool_down * 1000UL){
+        cooling_down = false;
+        wait_for_slaves();
+        start_next_plan();
+      }
+    }
+
+    //if a keystroke has been entered from the keypad; ignored while a run, a cool-down or a queue is under way
+    //so '*' or 'B' at the last prompt can't start a second run on top of it
+    if(key && !start_motor && !cooling_down && !queue_running){
       if(key == BACK_BUTTON && parameter_index > 0){
         setup_prev_input();
       }
@@ -358,11 +983,44 @@ void loop() {
           setup_next_input();
         }
       }
-      else if(key == SEND_INPUT && parameter_index == PARAMETER_NUM + 1){
-        send_inputs();
+      else if(parameter_index == PARAMETER_NUM + 1){
+        if(key == 'A'){
+          raw_capture = true;
+          setup_next_input();
+        }
+        else if(key == 'B'){
+          raw_capture = false;
+          setup_next_input();
+        }
+      }
+      else if(parameter_index == PARAMETER_NUM + 2){
+        if(key == 'A' || key == 'B' || key == 'C'){
+          control_mode = key == 'A' ? OPEN_LOOP : (key == 'B' ? HOLD_THRUST : HOLD_RPM);
+          setup_next_input();
+        }
+      }
+      else if(parameter_index == PARAMETER_NUM + 3){
+        if(key == SEND_INPUT){
+          send_inputs();
+        }
+        else if(key == 'A'){
+          if(queue.count == 0){ //the first plan sets where the automatic numbering starts
+            queue.next_test_number = parameter_values[0].toInt();
+          }
+          queue_add(plan_from_parameters());
+          parameter_index = 1; //straight on to the next plan's MAX
+          lcd_home();
+        }
+        else if(key == 'B'){
+          run_queue();
+        }
+        else if(key == 'C'){
+          clear_queue();
+          start_prompt();
+        }
       }
       else if(key >= '0' && key <= '9'){
-        if(input.length() < 3){ 
+        if(input.length() < (parameter_index == 0 ? TEST_NUMBER_LENGTH : MAX_INPUT_LENGTH)){
           input += key;
           lcd.print(key);
         }
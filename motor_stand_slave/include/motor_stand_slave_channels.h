@@ -0,0 +1,402 @@
+///////////////////////////////////////////////////////////////////////////////////////
+//CHANNEL DESCRIPTORS
+//(Every logged sensor is a type built from compile-time parameters: pin, conversion kernel, moving average
+//length, EEPROM calibration slot and the text for its CSV columns. ChannelTable expands each operation over
+//the CHANNEL TABLE at the bottom of this file, so the calls are inlined in table order with no loop or lookup,
+//and only the channels listed there take up RAM. To log a new sensor, add a descriptor to the table)
+
+//Channel text is a run of NUL separated fields in flash: converted column, raw column, then snapshot names
+const __FlashStringHelper* text_field(const char* text, uint8_t field){
+  while(field--){
+    text += strlen_P(text) + 1;
+  }
+  return (const __FlashStringHelper*)text;
+}
+
+void print_snapshot_value(Print& out, const __FlashStringHelper* name, float value){
+  out.print(F("# "));
+  out.print(name);
+  out.print(F(", "));
+  out.println(value, 6);
+}
+
+//Analog sensor read with analogRead(). ZERO holds its output voltage at rest, found by the analog tare and kept
+//at CAL_ADDRESS in EEPROM. TAPS is the moving average length of the logged value (1 logs it unfiltered)
+template<uint8_t PIN, float (*CONVERT)(int), float* ZERO, int CAL_ADDRESS, uint8_t TAPS, const char* TEXT>
+struct AnalogChannel {
+  static int raw;                             //ADC code of the current sample
+  static float reading;                       //converted, unfiltered
+  static float value;                         //converted and filtered; this is what gets logged
+  static float history[TAPS];
+  static uint8_t history_index;
+  static int burst[BURST_BUFFER_SIZE];        //ADC codes, converted while the burst drains
+
+  static void begin(){
+    pinMode(PIN, INPUT);
+  }
+
+  static void reset(){
+    for(uint8_t i = 0; i < TAPS; i++){
+      history[i] = 0;
+    }
+    history_index = 0;
+  }
+
+  static void read(){
+    raw = analogRead(PIN);
+  }
+
+  static void read_fast(){
+    read();
+  }
+
+  static float filter(float sample){
+    if(TAPS == 1){
+      return sample;
+    }
+    history[history_index] = sample;
+    history_index = (history_index + 1) % TAPS;
+    float sum = 0;
+    for(uint8_t i = 0; i < TAPS; i++){
+      sum += history[i];
+    }
+    return sum / TAPS;
+  }
+
+  static void convert(){
+    reading = CONVERT(raw);
+    value = filter(reading);
+  }
+
+  static void store(int slot){
+    burst[slot] = raw;
+  }
+
+  static const __FlashStringHelper* column(bool raw_format){
+    return text_field(TEXT, raw_format ? 1 : 0);
+  }
+
+  static const __FlashStringHelper* burst_column(bool raw_format){
+    return column(raw_format);
+  }
+
+  static void print_value(Print& out, bool raw_format){
+    if(raw_format){
+      out.print(raw);
+    }
+    else{
+      out.print(value);
+    }
+  }
+
+  static void print_burst_value(Print& out, int slot, bool raw_format){
+    if(raw_format){
+      out.print(burst[slot]);
+    }
+    else{
+      out.print(CONVERT(burst[slot]));
+    }
+  }
+
+  //Averages the pin voltage for 2 seconds with nothing applied to the sensor
+  static void zero(){
+    Serial.print(F("Zeroing "));
+    Serial.println(column(false));
+    unsigned long start_time = millis();
+    float average_raw = 0;
+    float samples = 0;
+    while(millis() < start_time + 2000){
+      samples++;
+      float reading = analogRead(PIN) * (Vcc / 1023);
+      average_raw += reading;
+
+      Serial.print(F("READING: "));
+      Serial.print(reading);
+      Serial.println(F(" KNOWN: 0"));
+      delay(5);
+    }
+    *ZERO = average_raw / samples;
+    EEPROM.put(CAL_ADDRESS, *ZERO);
+  }
+
+  static void restore(){
+    EEPROM.get(CAL_ADDRESS, *ZERO);
+    Serial.print(text_field(TEXT, 2));
+    Serial.print(F(": "));
+    Serial.println(*ZERO);
+  }
+
+  static void calibrate(float){}
+
+  static void snapshot(Print& out){
+    print_snapshot_value(out, text_field(TEXT, 2), *ZERO);
+  }
+
+  static void start_raw(){}
+  static void stop_raw(){}
+};
+
+template<uint8_t PIN, float (*CONVERT)(int), float* ZERO, int CAL_ADDRESS, uint8_t TAPS, const char* TEXT>
+int AnalogChannel<PIN, CONVERT, ZERO, CAL_ADDRESS, TAPS, TEXT>::raw;
+template<uint8_t PIN, float (*CONVERT)(int), float* ZERO, int CAL_ADDRESS, uint8_t TAPS, const char* TEXT>
+float AnalogChannel<PIN, CONVERT, ZERO, CAL_ADDRESS, TAPS, TEXT>::reading;
+template<uint8_t PIN, float (*CONVERT)(int), float* ZERO, int CAL_ADDRESS, uint8_t TAPS, const char* TEXT>
+float AnalogChannel<PIN, CONVERT, ZERO, CAL_ADDRESS, TAPS, TEXT>::value;
+template<uint8_t PIN, float (*CONVERT)(int), float* ZERO, int CAL_ADDRESS, uint8_t TAPS, const char* TEXT>
+float AnalogChannel<PIN, CONVERT, ZERO, CAL_ADDRESS, TAPS, TEXT>::history[TAPS];
+template<uint8_t PIN, float (*CONVERT)(int), float* ZERO, int CAL_ADDRESS, uint8_t TAPS, const char* TEXT>
+uint8_t AnalogChannel<PIN, CONVERT, ZERO, CAL_ADDRESS, TAPS, TEXT>::history_index;
+template<uint8_t PIN, float (*CONVERT)(int), float* ZERO, int CAL_ADDRESS, uint8_t TAPS, const char* TEXT>
+int AnalogChannel<PIN, CONVERT, ZERO, CAL_ADDRESS, TAPS, TEXT>::burst[BURST_BUFFER_SIZE];
+
+//HX711 load cell. Its calibration factor is found from a known load and kept at CAL_ADDRESS in EEPROM.
+//During raw capture the factor is set to 1, so getData() returns counts relative to the tare offset
+template<HX711_ADC* SENSOR, int CAL_ADDRESS, const char* TEXT>
+struct LoadCellChannel {
+  static float value;                         //getData() of the current sample
+  static float run_calibration;               //factor put aside while raw capture runs at a factor of 1
+  static float burst[BURST_BUFFER_SIZE];      //as logged
+
+  static void begin(){}
+  static void reset(){}
+
+  static void read(){
+    value = SENSOR->getData();
+  }
+
+  static void read_fast(){} //only 10 SPS; the burst ring repeats the latest sample
+
+  static void convert(){}
+
+  static void store(int slot){
+    burst[slot] = value;
+  }
+
+  static const __FlashStringHelper* column(bool raw_format){
+    return text_field(TEXT, raw_format ? 1 : 0);
+  }
+
+  static const __FlashStringHelper* burst_column(bool raw_format){
+    return column(raw_format);
+  }
+
+  static void print_value(Print& out, bool raw_format){
+    if(raw_format){
+      out.print((long)value);
+    }
+    else{
+      out.print(value);
+    }
+  }
+
+  static void print_burst_value(Print& out, int slot, bool raw_format){
+    if(raw_format){
+      out.print((long)burst[slot]);
+    }
+    else{
+      out.print(burst[slot]);
+    }
+  }
+
+  static void zero(){} //tared on startup and calibrated with a known load instead
+
+  static void restore(){
+    float cal_factor;
+    EEPROM.get(CAL_ADDRESS, cal_factor);
+    SENSOR->setCalFactor(cal_factor);
+    Serial.print(text_field(TEXT, 2));
+    Serial.print(F(": "));
+    Serial.println(cal_factor);
+  }
+
+  //Averages the readings from 2 to 4 seconds after the known load is applied
+  static void calibrate(float known){
+    SENSOR->setCalFactor(1);
+    unsigned long start_time = millis();
+    float average_raw = 0;
+    float samples = 0;
+    while(millis() < start_time + 4000){
+      if(SENSOR->update()){
+        float reading = SENSOR->getData();
+        if(millis() > start_time + 2000){
+          samples++;
+          average_raw += reading;
+
+          Serial.print(F("READING: "));
+          Serial.print(reading);
+          Serial.print(F(" KNOWN: "));
+          Serial.println(known);
+        }
+      }
+    }
+    average_raw = average_raw / samples;
+    float cal_factor = average_raw / known;
+    SENSOR->setCalFactor(cal_factor);
+    EEPROM.put(CAL_ADDRESS, cal_factor);
+  }
+
+  static void snapshot(Print& out){
+    print_snapshot_value(out, text_field(TEXT, 2), SENSOR->getCalFactor());
+    print_snapshot_value(out, text_field(TEXT, 3), SENSOR->getTareOffset());
+  }
+
+  static void start_raw(){
+    run_calibration = SENSOR->getCalFactor();
+    SENSOR->setCalFactor(1);
+  }
+
+  static void stop_raw(){
+    SENSOR->setCalFactor(run_calibration);
+  }
+
+  //The sample in calibrated units whatever the capture mode
+  static float physical(){
+    return raw_capture ? value / run_calibration : value;
+  }
+};
+
+template<HX711_ADC* SENSOR, int CAL_ADDRESS, const char* TEXT>
+float LoadCellChannel<SENSOR, CAL_ADDRESS, TEXT>::value;
+template<HX711_ADC* SENSOR, int CAL_ADDRESS, const char* TEXT>
+float LoadCellChannel<SENSOR, CAL_ADDRESS, TEXT>::run_calibration;
+template<HX711_ADC* SENSOR, int CAL_ADDRESS, const char* TEXT>
+float LoadCellChannel<SENSOR, CAL_ADDRESS, TEXT>::burst[BURST_BUFFER_SIZE];
+
+//Tachometer. Logs RPM (updated every 250 ms in loop()) converted, or the edge count and the time of the last edge
+//raw, so RPM can be recomputed offline over any window
+struct TachChannel {
+  static unsigned long edges;
+  static unsigned long edge_time;
+  static unsigned int burst[BURST_BUFFER_SIZE]; //low 16 bits of the edge count
+
+  static void begin(){
+    pinMode(RPM_PIN, INPUT);
+  }
+
+  static void reset(){}
+
+  static void read(){
+    noInterrupts();
+    edges = tach_edges;
+    edge_time = last_edge_micros;
+    interrupts();
+  }
+
+  static void read_fast(){
+    read();
+  }
+
+  static void convert(){}
+
+  static void store(int slot){
+    burst[slot] = edges;
+  }
+
+  static const __FlashStringHelper* column(bool raw_format){
+    return raw_format ? F("Tach edges, Last edge (us)") : F("RPM");
+  }
+
+  static const __FlashStringHelper* burst_column(bool){
+    return F("Tach edges");
+  }
+
+  static void print_value(Print& out, bool raw_format){
+    if(raw_format){
+      out.print(edges); out.print(F(", "));
+      out.print(edge_time);
+    }
+    else{
+      out.print(RPM);
+    }
+  }
+
+  static void print_burst_value(Print& out, int slot, bool){
+    out.print(burst[slot]);
+  }
+
+  static void zero(){}
+  static void restore(){}
+  static void calibrate(float){}
+
+  static void snapshot(Print& out){
+    print_snapshot_value(out, F("MARKERS"), MARKERS);
+  }
+
+  static void start_raw(){}
+  static void stop_raw(){}
+};
+
+unsigned long TachChannel::edges;
+unsigned long TachChannel::edge_time;
+unsigned int TachChannel::burst[BURST_BUFFER_SIZE];
+
+//Runs one expression per channel in table order; the array only exists to sequence the pack expansion
+#define FOR_EACH_CHANNEL(expression) { int order[] = {0, ((expression), 0)...}; (void)order; }
+
+template<typename... Channel>
+struct ChannelTable {
+  static void begin(){ FOR_EACH_CHANNEL(Channel::begin()); }
+  static void reset(){ FOR_EACH_CHANNEL(Channel::reset()); }
+  static void read(){ FOR_EACH_CHANNEL(Channel::read()); }
+  static void read_fast(){ FOR_EACH_CHANNEL(Channel::read_fast()); } //what can be read on any loop pass, for the burst ring
+  static void convert(){ FOR_EACH_CHANNEL(Channel::convert()); }
+  static void store(int slot){ FOR_EACH_CHANNEL(Channel::store(slot)); }
+  static void zero(){ FOR_EACH_CHANNEL(Channel::zero()); }
+  static void restore(){ FOR_EACH_CHANNEL(Channel::restore()); }
+  static void snapshot(Print& out){ FOR_EACH_CHANNEL(Channel::snapshot(out)); }
+  static void start_raw(){ FOR_EACH_CHANNEL(Channel::start_raw()); }
+  static void stop_raw(){ FOR_EACH_CHANNEL(Channel::stop_raw()); }
+
+  static void print_header(Print& out, bool raw_format){
+    out.print(F("Time (ms)"));
+    FOR_EACH_CHANNEL((out.print(F(", ")), out.print(Channel::column(raw_format))));
+    out.println();
+  }
+
+  static void print_row(Print& out, bool raw_format){
+    out.print(millis() - run_start_timestamp);
+    FOR_EACH_CHANNEL((out.print(F(", ")), Channel::print_value(out, raw_format)));
+    out.println();
+  }
+
+  static void print_burst_header(Print& out, bool raw_format){
+    out.print(F("Burst, Setpoint, Offset (ms)"));
+    FOR_EACH_CHANNEL((out.print(F(", ")), out.print(Channel::burst_column(raw_format))));
+    out.println();
+  }
+
+  static void print_burst_values(Print& out, int slot, bool raw_format){
+    FOR_EACH_CHANNEL((out.print(F(", ")), Channel::print_burst_value(out, slot, raw_format)));
+    out.println();
+  }
+
+  static void print_status(Print& out){
+    FOR_EACH_CHANNEL((out.print(F(" | ")), out.print(Channel::column(false)), out.print(F(": ")), Channel::print_value(out, false)));
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+//CHANNEL TABLE
+//(Column order is the CSV column order. tools/reprocess_raw.py finds raw columns by the names in the header row,
+//so keep a channel's raw column name once files exist; the snapshot names are the constant names it looks up.
+//A new channel needs its conversion kernel, a text string, a zero global and a free EEPROM slot, then a line here)
+
+float convert_current(int raw);
+float convert_voltage(int raw);
+float convert_airspeed(int raw);
+
+const char CURRENT_TEXT[] PROGMEM = "Current (A)\0Current (ADC)\0ZERO_CURRENT_VOLTAGE";
+const char VOLTAGE_TEXT[] PROGMEM = "Voltage (V)\0Voltage (ADC)\0ZERO_VOLTAGE";
+const char TORQUE_TEXT[] PROGMEM = "Torque (N.mm)\0Torque (counts)\0TORQUE_CAL_FACTOR\0TORQUE_TARE_OFFSET";
+const char THRUST_TEXT[] PROGMEM = "Thrust (N)\0Thrust (counts)\0THRUST_CAL_FACTOR\0THRUST_TARE_OFFSET";
+const char AIRSPEED_TEXT[] PROGMEM = "Airspeed (m/s)\0Airspeed (ADC)\0zeroVoltage";
+
+//                    pin           conversion        zero                   EEPROM  taps  text
+typedef AnalogChannel<CURRENT_PIN,  convert_current,  &ZERO_CURRENT_VOLTAGE, 30,     5,    CURRENT_TEXT>  CurrentChannel;
+typedef AnalogChannel<VOLTAGE_PIN,  convert_voltage,  &ZERO_VOLTAGE,         40,     1,    VOLTAGE_TEXT>  VoltageChannel;
+typedef AnalogChannel<AIRSPEED_PIN, convert_airspeed, &zeroVoltage,          20,     1,    AIRSPEED_TEXT> AirspeedChannel;
+//                      sensor         EEPROM  text
+typedef LoadCellChannel<&TorqueSensor, 0,      TORQUE_TEXT> TorqueChannel;
+typedef LoadCellChannel<&ThrustSensor, 10,     THRUST_TEXT> ThrustChannel;
+
+typedef ChannelTable<CurrentChannel, VoltageChannel, TorqueChannel, ThrustChannel, TachChannel, AirspeedChannel> Channels;
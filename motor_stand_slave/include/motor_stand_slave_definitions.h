@@ -55,8 +55,6 @@ float ZERO_CURRENT_VOLTAGE;
 float ZERO_VOLTAGE;
 float VOLTAGE_CALIBRATION = 18.8;
 
-float measurements[5] = {0, 0, 0, 0, 0};
-
 ///////////////////////////////////////////////////////////////////////////////////////
 // TIMING VARIABLE DEFINITIONS (FOR TRACKING)
 
@@ -69,6 +67,13 @@ bool ready;
 
 const int SD_PIN = 10; //change this to change the SD card pin number
 
+//I2C address is SLAVE_ADDRESS_FIRST plus the address jumpers (a pin jumpered to ground adds 1 or 2), so up to four
+//slaves can share the bus. Run events from the master arrive as general calls, which every slave accepts
+const int SLAVE_ADDRESS_FIRST = 9;
+const int ADDRESS_PIN_0 = 8;
+const int ADDRESS_PIN_1 = 9;
+int slave_address;
+
 String signal;
 File data_file; 
 bool reading_on;
@@ -80,5 +85,74 @@ bool zero_thrust;
 bool zero_analog_sensors;
 bool use_prev_calibration;
 bool paused;
+bool next_run_queued; //the master has more queued runs, so stop without re-initializing (and re-taring) the sensors
+
+///////////////////////////////////////////////////////////////////////////////////////
+//RAW CAPTURE DEFINITIONS
+//(Logs unconverted sensor counts plus a calibration snapshot; convert offline with tools/reprocess_raw.py)
+
+bool raw_capture;                         //set by the master before the file is created
+volatile unsigned long tach_edges;        //every tachometer edge, counted in the ISR
+volatile unsigned long last_edge_micros;  //timestamp of the most recent tachometer edge
+unsigned long run_start_timestamp;
+unsigned long last_flush_timestamp;
+const int RAW_FLUSH_INTERVAL = 1000;      //raw rows are written every sample, but only flushed to the SD card once a second
+
+///////////////////////////////////////////////////////////////////////////////////////
+//BURST CAPTURE DEFINITIONS
+//(A RAM ring samples the channels every BURST_SAMPLE_INTERVAL, paused or not: current, voltage, airspeed and tach
+//are read for it, the load cells (10 SPS) repeat their latest sample. The master sends 't' when an open loop ramp
+//reaches its step or when a hold target changes. BURST_PRE_TRIGGER samples from before it are kept plus the samples
+//after it, then the ring is drained to BRST_<test #>.csv one row per loop.
+//Each channel keeps its own column of the ring (see motor_stand_slave_channels.h); only the timestamps are kept here)
+
+const int BURST_BUFFER_SIZE = 16;   //18 bytes per sample with the default channels
+const int BURST_PRE_TRIGGER = 4;
+const int BURST_SAMPLE_INTERVAL = 20; //ms, 50 Hz: 80 ms before the trigger, 240 ms after; 0 samples on every loop pass
+
+enum BurstState {BURST_ARMED, BURST_CAPTURING, BURST_DRAINING};
+
+File burst_file;
+unsigned int burst_time[BURST_BUFFER_SIZE]; //low 16 bits of millis(), wraps safely for offsets under 32 s
+BurstState burst_state;
+int burst_head;                     //next slot to write
+int burst_filled;
+int burst_remaining;                //post-trigger samples left to capture, then rows left to drain
+int burst_count;                    //triggers captured this run
+unsigned long burst_trigger_timestamp;
+long burst_trigger_setpoint;        //burst_setpoint latched when the capture started
+volatile long burst_setpoint;       //PWM cycle length the master is stepping to, or the thrust/RPM target when holding
+volatile bool burst_trigger;
+unsigned long last_burst_sample_timestamp;
+
+///////////////////////////////////////////////////////////////////////////////////////
+//LIVE READINGS AND HOLD RESULTS
+//(Every I2C request is answered with the ready byte followed by the latest thrust and RPM as two floats,
+//which the master's closed-loop hold mode runs its PID on, then the peak stack depth in bytes.
+//Hold results from the master go to HOLD_<test #>.csv)
+
+const int STATUS_LENGTH = 1 + 2 * sizeof(float) + sizeof(uint16_t);
+
+float live_thrust;       //written with interrupts off since requestEvent() reads them from the I2C ISR
+float live_rpm;
+unsigned long prev_edges; //tach_edges at the last raw capture RPM update
+int test_number;
+const int HOLD_LINE_LENGTH = 32;  //a whole I2C message fits (the Wire buffer is 32 bytes)
+char hold_line[HOLD_LINE_LENGTH]; //the 'h' payload, copied out of signal in the ISR since the next 't' overwrites signal
+volatile bool hold_result;
+
+///////////////////////////////////////////////////////////////////////////////////////
+//SAFETY WATCHDOG DEFINITIONS
+//(KILL_PIN is wired to the master's e-stop line. Pulling it low trips the master's ESC kill ISR directly,
+//without waiting for the I2C link; it stays low until the run ends. The check runs on every loop pass, so the
+//worst-case trip is one pass plus the check (limit_trip_latency in tools/bench.py, SD writes not included).
+//SET THE LIMITS TO THE RIG'S RATINGS)
+
+const int KILL_PIN = 7;
+const float MAX_CURRENT = 50.0;   //A, read fresh on every loop pass, before averaging
+const float MAX_THRUST = 50.0;    //N, either direction
+const float MAX_RPM = 30000.0;
+bool tripped;
+float watchdog_current;           //A, the last reading the watchdog took
 
 ///////////////////////////////////////////////////////////////////////////////////////
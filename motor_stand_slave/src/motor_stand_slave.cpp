@@ -1,5 +1,8 @@
 #include <Arduino.h>
 #include <motor_stand_slave_definitions.h>
+#include <motor_stand_slave_channels.h>
+#include <motor_stand_slave_memory.h>
+#include <motor_stand_slave_benchmark.h>
 
 ////////////////////////////////////////////////////////////////////////////////////////
 //HELPER FUNCTIONS
@@ -20,21 +23,30 @@ void receiveEvent(int bytes){
     marker_sent = true;
   }
   else if(type == 'q'){ //torque
+    ready = false; //cleared here, not in loop(), so the master's next poll can't see a stale ready
     zero_torque = true;
   }
   else if(type == 'r'){ //thrust
+    ready = false;
     zero_thrust = true;
   }
   else if(type == 'a'){ //analog
+    ready = false;
     zero_analog_sensors = true;
   }
   else if(type == 'p'){ //previous
     use_prev_calibration = true;
   }
+  else if(type == 'x'){ // raw capture on/off for the next file
+    raw_capture = signal.toInt() == 1;
+  }
   else if(type == 'b'){ // START data collection
+    run_start_timestamp = millis();
     reading_on = true;
   }
   else if(type == 'e'){ // STOP data collection
+    ready = false; //the master waits on this before the next queued run
+    next_run_queued = signal.toInt() == 1;
     stop = true;
     reading_on = false;
   }
@@ -44,14 +56,30 @@ void receiveEvent(int bytes){
   else if(type == 'g'){
     paused = false;
   }
+  else if(type == 't'){ // setpoint change, start a burst capture
+    burst_setpoint = signal.toInt();
+    burst_trigger = true;
+  }
+  else if(type == 'h'){ // closed-loop hold result
+    strncpy(hold_line, signal.c_str(), HOLD_LINE_LENGTH - 1);
+    hold_line[HOLD_LINE_LENGTH - 1] = '\0';
+    hold_result = true;
+  }
 }
 
 void requestEvent(){
-  Wire.write(ready); //tells the master initialization status
+  uint8_t status[STATUS_LENGTH];
+  status[0] = ready; //tells the master initialization status
+  memcpy(status + 1, &live_thrust, sizeof(float));
+  memcpy(status + 1 + sizeof(float), &live_rpm, sizeof(float));
+  memcpy(status + 1 + 2 * sizeof(float), &peak_stack, sizeof(peak_stack));
+  Wire.write(status, sizeof(status));
 }
 
 void count(){
   see_object = true;
+  tach_edges++;
+  last_edge_micros = micros();
 }
 
 void increment(){
@@ -61,50 +89,6 @@ void increment(){
   }
 }
 
-float zero_analog(float (*func)(), int address){
-  unsigned long start_time = millis();
-  float average_raw = 0;
-  float samples = 0;
-  while(millis() < start_time + 2000){
-    samples++;
-    float reading = func();
-    average_raw += reading;
-
-    Serial.print(F("READING: "));
-    Serial.print(reading);
-    Serial.println(F(" KNOWN: 0"));   
-    delay(5); 
-  }
-  average_raw = average_raw / samples;
-  EEPROM.put(address, average_raw);
-  return average_raw;
-}
-
-void calibrate_hx711(HX711_ADC& load_cell, float known, int address){
-  load_cell.setCalFactor(1);
-  unsigned long start_time = millis();
-  float average_raw = 0;
-  float samples = 0;
-  while(millis() < start_time + 4000){
-    if(load_cell.update()){
-      float reading = load_cell.getData();
-      if(millis() > start_time + 2000){
-        samples++;
-        average_raw += reading;
-
-        Serial.print(F("READING: "));
-        Serial.print(reading);
-        Serial.print(F(" KNOWN: "));
-        Serial.println(known);
-      }
-    }
-  }
-  average_raw = average_raw / samples;
-  float cal_factor = average_raw / known;
-  load_cell.setCalFactor(cal_factor);
-  EEPROM.put(address, cal_factor);
-}
-
 // Initializes Load Cell
 void init_LoadCell () {
   Serial.println(F("Initializing the HX711 . . ."));
@@ -129,48 +113,322 @@ void init_LoadCell () {
   Serial.println(F("Done initializing HX711"));
 }
 
-extern int __heap_start, *__brkval;
-int free_memory() {
-  int v;
-  return (int)&v - (__brkval == 0 ? (int)&__heap_start : (int)__brkval);
+//CONVERSION KERNELS (mirrored by tools/reprocess_raw.py, keep the two in sync)
+float convert_current(int raw){
+  float current_voltage = raw * (Vcc / 1023.0);
+  return (current_voltage - ZERO_CURRENT_VOLTAGE) / CURRENT_SENSITIVITY;
+}
+
+float convert_voltage(int raw){
+  return VOLTAGE_CALIBRATION * ((raw * (Vcc / 1023.0)) - ZERO_VOLTAGE);
+}
+
+float convert_airspeed(int raw){
+  float airspeed_voltage = raw * (Vcc / 1023.0);
+
+  float pressure_kPa = (airspeed_voltage - zeroVoltage) / sensitivity; // Convert voltage to differential pressure in kPa
+  float pressure_Pa = pressure_kPa * 1000.0; // Convert kPa to Pascals
+
+  if (pressure_Pa > 0) {
+    return sqrt((2.0 * pressure_Pa) / airDensity); // Compute airspeed using Bernoulli equation
+  }
+  return 0.0;
+}
+
+//Writes every constant the conversion kernels use (the fixed ones here, each channel's calibration from the table),
+//then drops the load cells to a calibration factor of 1 so that getData() returns counts relative to the tare offset
+void start_raw_capture(){
+  data_file.println(F("# RAW CAPTURE"));
+  print_snapshot_value(data_file, F("Vcc"), Vcc);
+  print_snapshot_value(data_file, F("sensitivity"), sensitivity);
+  print_snapshot_value(data_file, F("airDensity"), airDensity);
+  print_snapshot_value(data_file, F("CURRENT_SENSITIVITY"), CURRENT_SENSITIVITY);
+  print_snapshot_value(data_file, F("VOLTAGE_CALIBRATION"), VOLTAGE_CALIBRATION);
+  Channels::snapshot(data_file);
+  Channels::print_header(data_file, true);
+
+  Channels::start_raw();
+  last_flush_timestamp = millis();
+  noInterrupts();
+  prev_edges = tach_edges;
+  interrupts();
+}
+
+void stop_raw_capture(){
+  Channels::stop_raw();
+  raw_capture = false;
+}
+
+//ROW FORMATTING (data rows come from Channels::print_row; takes any Print so the benchmark build can time it without an SD card)
+void print_burst_row(Print& out, int slot){
+  out.print(burst_count); out.print(", ");
+  out.print(burst_trigger_setpoint); out.print(", ");
+  out.print((int)(burst_time[slot] - (unsigned int)burst_trigger_timestamp));
+  Channels::print_burst_values(out, slot, raw_capture);
+}
+
+//One row per load cell sample with no conversion; only the SD card write is left on the device
+void log_raw_sample(){
+  Channels::print_row(data_file, true);
+
+  if(millis() > last_flush_timestamp + RAW_FLUSH_INTERVAL){
+    last_flush_timestamp = millis();
+    data_file.flush();
+  }
+}
+
+void update_live_readings(float thrust, float rpm){
+  noInterrupts();
+  live_thrust = thrust;
+  live_rpm = rpm;
+  interrupts();
+}
+
+//Appends one "target, settling time, steady-state error" line sent by the master
+void log_hold_result(){
+  File hold_file = SD.open("HOLD_" + String(test_number) + ".csv", FILE_WRITE);
+  if(hold_file){
+    if(hold_file.size() == 0){
+      hold_file.println(F("Target, Settling time (ms), Steady-state error"));
+    }
+    hold_file.println(hold_line);
+    hold_file.close();
+  }
+}
+
+//Open-drain drive: released (input) while healthy, pulled low to trip the master. Returns true on the pass that trips
+bool check_limits(float current, float thrust, float rpm){
+  if(tripped){
+    return false;
+  }
+  if(abs(current) > MAX_CURRENT || abs(thrust) > MAX_THRUST || rpm > MAX_RPM){
+    digitalWrite(KILL_PIN, LOW);
+    pinMode(KILL_PIN, OUTPUT);
+    tripped = true;
+    return true;
+  }
+  return false;
+}
+
+//Runs on every loop pass of a run, whether or not a load cell sample is ready or the file opened, on a current
+//reading taken for it that pass; thrust and RPM are the latest values from the sampling code
+bool watchdog(int current_raw){
+  watchdog_current = convert_current(current_raw);
+  return check_limits(watchdog_current, live_thrust, RPM);
+}
+
+//Only after KILL_PIN is already low, so the Serial time doesn't add to the trip
+void report_trip(){
+  Serial.print(F("LIMIT TRIPPED | Current: ")); Serial.print(watchdog_current);
+  Serial.print(F(" | Thrust: ")); Serial.print(live_thrust);
+  Serial.print(F(" | RPM: ")); Serial.println(RPM);
+}
+
+void reset_burst(){
+  burst_state = BURST_ARMED;
+  burst_head = 0;
+  burst_filled = 0;
+  burst_count = 0;
+  burst_trigger = false;
+  last_burst_sample_timestamp = millis();
+}
+
+//Called after the channels are read; costs one copy per channel while armed or capturing and nothing while draining
+void record_burst_sample(){
+  if(burst_state == BURST_DRAINING){
+    burst_trigger = false; //a trigger that lands mid-burst is dropped
+    return;
+  }
+
+  if(burst_trigger && burst_state == BURST_ARMED){
+    burst_state = BURST_CAPTURING;
+    burst_trigger_timestamp = millis();
+    noInterrupts();
+    burst_trigger_setpoint = burst_setpoint;
+    interrupts();
+    burst_remaining = BURST_BUFFER_SIZE - min(burst_filled, BURST_PRE_TRIGGER);
+    burst_filled = min(burst_filled, BURST_PRE_TRIGGER); //only the newest pre-trigger samples are kept
+    burst_count++;
+  }
+  burst_trigger = false;
+
+  burst_time[burst_head] = millis();
+  Channels::store(burst_head);
+
+  burst_head = (burst_head + 1) % BURST_BUFFER_SIZE;
+  burst_filled = min(burst_filled + 1, BURST_BUFFER_SIZE);
+
+  if(burst_state == BURST_CAPTURING && --burst_remaining == 0){
+    burst_state = BURST_DRAINING;
+    burst_remaining = burst_filled;
+  }
+}
+
+//The ring runs on its own clock rather than the load cells': every BURST_SAMPLE_INTERVAL the analog channels and
+//the tach are read for it, and the load cells put in their latest sample
+void sample_burst(){
+  if(millis() - last_burst_sample_timestamp < BURST_SAMPLE_INTERVAL){
+    return;
+  }
+  last_burst_sample_timestamp = millis();
+  Channels::read_fast();
+  record_burst_sample();
+}
+
+//Writes one buffered sample per call so the SD card time is spread over the following loop passes
+void drain_burst(){
+  if(burst_state != BURST_DRAINING){
+    return;
+  }
+
+  print_burst_row(burst_file, (burst_head + BURST_BUFFER_SIZE - burst_remaining) % BURST_BUFFER_SIZE);
+
+  if(--burst_remaining == 0){
+    burst_file.flush();
+    burst_state = BURST_ARMED;
+    burst_filled = 0;
+  }
+}
+
+#ifdef BENCHMARK
+////////////////////////////////////////////////////////////////////////////////////////
+//BENCHMARKS (synthetic sensor data; the SD card is replaced by a NullPrint, the I2C link is not exercised)
+
+//analogRead and the HX711 return 0 in the simulator, so synthetic readings replace whatever Channels::read() left.
+//Assigned, not added, since several benchmarks call this without a read in between
+void bench_fill(const int adc[], const float load[], int i){
+  CurrentChannel::raw = adc[i & 7];
+  VoltageChannel::raw = adc[(i + 1) & 7];
+  AirspeedChannel::raw = adc[(i + 2) & 7];
+  TorqueChannel::value = load[i & 7];
+  ThrustChannel::value = load[(i + 1) & 7];
+}
+
+//One converted-mode sample as loop() handles it, minus the HX711 wait
+void bench_sample(Print& out, const int adc[], const float load[], int i){
+  Channels::read();
+  bench_fill(adc, load, i);
+  Channels::convert();
+  update_live_readings(ThrustChannel::value, RPM);
+  Channels::print_row(out, false);
+}
+
+//Worst case from a current over the limit to KILL_PIN low: the overcurrent lands just after one pass's watchdog read,
+//so it waits out that pass with a load cell sample in it (the HX711 reads included, the SD write not) and is caught
+//by the watchdog at the top of the next pass
+unsigned long bench_limit_trip_latency(Print& out, const int adc[], const float load[], int i){
+  tripped = false;
+  unsigned long start = bench_ticks();
+  TorqueSensor.update();
+  ThrustSensor.update();
+  bench_sample(out, adc, load, i);
+  watchdog(analogRead(CURRENT_PIN) + 1023); //a full scale code is far over MAX_CURRENT
+  unsigned long cycles = (bench_ticks() - start) * 8;
+  pinMode(KILL_PIN, INPUT); //release the line for the next pass
+  return cycles;
 }
 
+void run_benchmarks(){
+  Serial.begin(57600);
+  bench_begin();
+  NullPrint sink;
+
+  //synthetic readings around a mid-throttle operating point, all under the watchdog limits (current tops out
+  //near 36 A) so the timed passes never take the trip path
+  int adc[8];
+  float load[8];
+  for(int i = 0; i < 8; i++){
+    adc[i] = 520 + i * 20;
+    load[i] = 120.5 + i * 17.25;
+  }
+  zeroVoltage = 2.7;
+  ZERO_CURRENT_VOLTAGE = 2.5;
+  ZERO_VOLTAGE = 0.01;
+  MARKERS = 2;
+  RPM = 5400;
+  reset_burst();
+  TorqueSensor.begin();
+
+  int n = 0;
+  BENCH("convert_current", bench_sink = convert_current(adc[n++ & 7]));
+  BENCH("convert_voltage", bench_sink = convert_voltage(adc[n++ & 7]));
+  BENCH("convert_airspeed", bench_sink = convert_airspeed(adc[n++ & 7]));
+  BENCH("average_current", bench_sink = CurrentChannel::filter(load[n++ & 7]));
+  BENCH("limit_check", check_limits(load[n & 7] * 0.1, load[(n + 1) & 7] * 0.1, RPM); n++);
+  BENCH("watchdog_pass", watchdog(analogRead(CURRENT_PIN) + adc[n++ & 7]));
+  BENCH("analog_read", bench_sink = analogRead(CURRENT_PIN));
+  BENCH("hx711_update", bench_sink = TorqueSensor.update());
+  BENCH("channel_read", Channels::read());
+  BENCH("burst_record", Channels::read_fast(); bench_fill(adc, load, n++); record_burst_sample());
+  BENCH("log_converted_row", bench_fill(adc, load, n++); Channels::convert(); Channels::print_row(sink, false));
+  BENCH("log_raw_row", bench_fill(adc, load, n++); Channels::print_row(sink, true));
+  BENCH("log_burst_row", print_burst_row(sink, n++ % BURST_BUFFER_SIZE));
+  BENCH("sample_pipeline", bench_sample(sink, adc, load, n++));
+
+  unsigned long worst_trip = 0;
+  for(int i = 0; i < BENCH_ITERATIONS; i++){
+    worst_trip = max(worst_trip, bench_limit_trip_latency(sink, adc, load, n++));
+  }
+  bench_report(F("limit_trip_latency"), worst_trip);
+  tripped = false;
+
+  bench_memory_report();
+  bench_end();
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////////////
 //MAIN DRIVER CODE
 
-void setup(){
+//Clears everything a test run leaves behind; the sensors, their tare and the SD card are left as they are
+void reset_run(){
   signal = "";
   reading_on = false;
   stop = false;
+  next_run_queued = false;
   new_file_created = false;
   marker_sent = false;
   zero_torque = false;
   zero_thrust = false;
   paused = false;
+  raw_capture = false;
+  hold_result = false;
+  update_live_readings(0, 0);
+  reset_burst();
   RPM = 0;
-  ready = false;
   last_serial_timestamp = 0;
-  for(int i = 0; i < 5; i++){
-    measurements[i] = 0;
-  }
+  Channels::reset();
+}
+
+void setup(){
+#ifdef BENCHMARK
+  run_benchmarks(); //never returns
+#endif
+  reset_run();
+  ready = false;
 
-  pinMode(CURRENT_PIN, INPUT);
-  pinMode(VOLTAGE_PIN, INPUT);
+  Channels::begin();
+
+  pinMode(KILL_PIN, INPUT); //release the e-stop line
+  tripped = false;
 
-  pinMode(RPM_PIN, INPUT);
   see_object = false;
   attachInterrupt(digitalPinToInterrupt(RPM_PIN), count, CHANGE);
 
   //Initialize I2C protocol (slave)
-  Wire.begin(9); //Slave arduino set to address 9
+  pinMode(ADDRESS_PIN_0, INPUT_PULLUP);
+  pinMode(ADDRESS_PIN_1, INPUT_PULLUP);
+  slave_address = SLAVE_ADDRESS_FIRST + (digitalRead(ADDRESS_PIN_0) == LOW) + 2 * (digitalRead(ADDRESS_PIN_1) == LOW);
+  Wire.begin(slave_address);
+  TWAR |= _BV(TWGCE); //also answer the master's general call broadcasts
   Wire.onReceive(receiveEvent);
   Wire.onRequest(requestEvent);
 
   //Initialize Serial
   Serial.begin(57600);
-  Serial.println(F("Setting up"));
-  Serial.print(F("Free RAM (in bytes): "));
-  Serial.println(free_memory());
+  Serial.print(F("Setting up at I2C address "));
+  Serial.println(slave_address);
+  print_memory(Serial);
 
   init_LoadCell(); //initialze the load cell
 
@@ -184,33 +442,15 @@ void setup(){
 }
 
 void loop(){
-  if(use_prev_calibration){
-    Serial.println(F("Retrieving calibration factors"));
-
-    float torque_calibration_factor;
-    EEPROM.get(0, torque_calibration_factor);
-    TorqueSensor.setCalFactor(torque_calibration_factor);
-    Serial.print(F("Torque: "));
-    Serial.println(String(torque_calibration_factor));
-
-    float thrust_calibration_factor;
-    EEPROM.get(10, thrust_calibration_factor);
-    ThrustSensor.setCalFactor(thrust_calibration_factor);
-    Serial.print(F("Thrust: "));
-    Serial.println(String(thrust_calibration_factor));
-
-    EEPROM.get(20, zeroVoltage);
-    Serial.print(F("Airspeed: "));
-    Serial.println(String(zeroVoltage));
-
-    EEPROM.get(30, ZERO_CURRENT_VOLTAGE);
-    Serial.print(F("Current: "));
-    Serial.println(String(ZERO_CURRENT_VOLTAGE));
+  update_peak_stack();
 
-    EEPROM.get(40, ZERO_VOLTAGE);
-    Serial.print(F("Current: "));
-    Serial.println(String(ZERO_VOLTAGE));
+  if(reading_on && watchdog(analogRead(CURRENT_PIN))){
+    report_trip();
+  }
 
+  if(use_prev_calibration){
+    Serial.println(F("Retrieving calibration factors"));
+    Channels::restore();
     Serial.println(F("Done retrieving calibration factors"));
     use_prev_calibration = false;
   }
@@ -219,7 +459,7 @@ void loop(){
     ready = false;
     KNOWN_TORQUE = signal.toInt();
     Serial.println(F("Calibrating torque sensor"));
-    calibrate_hx711(TorqueSensor, KNOWN_TORQUE, 0);
+    TorqueChannel::calibrate(KNOWN_TORQUE);
     Serial.println(F("Done calibrating torque sensor"));
     zero_torque = false;
     ready = true;
@@ -230,7 +470,7 @@ void loop(){
     KNOWN_THRUST = signal.toInt();
 
     Serial.println(F("Calibrating thrust sensor"));
-    calibrate_hx711(ThrustSensor, KNOWN_THRUST, 10);
+    ThrustChannel::calibrate(KNOWN_THRUST);
     Serial.println(F("Done Calibrating thrust sensor"));
 
     zero_thrust = false;
@@ -239,18 +479,8 @@ void loop(){
 
   if(zero_analog_sensors){
     ready = false;
-    Serial.println(F("Zeroing the airspeed sensor"));
-    zeroVoltage = zero_analog([]() {return analogRead(AIRSPEED_PIN) * (Vcc / 1023);}, 20);
-    Serial.println(F("Done zeroing airspeed sensor"));
-
-    Serial.println(F("Zeroing the current sensor"));
-    ZERO_CURRENT_VOLTAGE = zero_analog([]() {return analogRead(CURRENT_PIN) * (Vcc / 1023);}, 30);
-    Serial.println(F("Done zeroing current sensor"));
-
-    Serial.println(F("Zeroing the voltage sensor"));
-    ZERO_VOLTAGE = zero_analog([]() {return analogRead(VOLTAGE_PIN) * (Vcc / 1023);}, 40);
-    Serial.println(F("Done zeroing voltage sensor"));
-    
+    Channels::zero();
+    Serial.println(F("Done zeroing analog sensors"));
     zero_analog_sensors = false;
     ready = true;
   }
@@ -258,10 +488,27 @@ void loop(){
   if(new_file_created){ //create a new file
     String file_name = "TEST_" + signal + ".csv";
     data_file = SD.open(file_name, FILE_WRITE); //create the file
-    data_file.println("Current (A), Voltage (V), Torque (N.mm), Thrust (N), RPM, Airspeed (m/s)"); //set up csv headers
+    test_number = signal.toInt();
+    burst_file = SD.open("BRST_" + signal + ".csv", FILE_WRITE);
+    if(!data_file){
+      Serial.println(F("Could not open the data file"));
+    }
+    if(raw_capture){
+      start_raw_capture();
+    }
+    else{
+      Channels::print_header(data_file, false); //set up csv headers
+    }
+    Channels::print_burst_header(burst_file, raw_capture);
+    reset_burst();
     new_file_created = false;
   }
 
+  if(hold_result){
+    log_hold_result();
+    hold_result = false;
+  }
+
   if(marker_sent){
     MARKERS = signal.toInt();
     Serial.println(String(MARKERS));
@@ -269,81 +516,75 @@ void loop(){
   }
 
   if(data_file){
-    if(reading_on){ //if a file exists and data logging/testing is turned on
+    if(reading_on && raw_capture){
+      if(millis() >= prev_second + 250){
+        noInterrupts();
+        unsigned long edges = tach_edges;
+        interrupts();
+        RPM = ((edges - prev_edges) / (MARKERS * 2)) * 240.0;
+        prev_edges = edges;
+        prev_second = millis();
+      }
+
+      sample_burst();
+      if(TorqueSensor.update() && ThrustSensor.update()){
+        Channels::read();
+        update_live_readings(ThrustChannel::physical(), RPM);
+        if(!paused){
+          log_raw_sample();
+        }
+      }
+      drain_burst();
+    }
+    else if(reading_on){ //if a file exists and data logging/testing is turned on
       //RPM SENSOR READING AND CALCULATION; Can increase precision by adding more markers
       if(millis() >= prev_second + 250){
         RPM = (objects / (MARKERS * 2)) * 240.0;
         objects = 0;
         prev_second = millis();
       }
-      
-      if(TorqueSensor.update() && ThrustSensor.update()){
-        //CURRENT/VOLTAGE SENSOR READING
-        int current_value_in = analogRead(CURRENT_PIN);
-        int voltage_value_in = analogRead(VOLTAGE_PIN);          
-
-        float voltage = VOLTAGE_CALIBRATION * ((voltage_value_in * (Vcc / 1023.0)) - ZERO_VOLTAGE);
-
-        float current_voltage = current_value_in * (Vcc / 1023.0);
-        float current = (current_voltage - ZERO_CURRENT_VOLTAGE) / CURRENT_SENSITIVITY;
-        
-        float prev = measurements[0];
-        measurements[0] = current;
-        for(int i = 1; i < 5; i++){
-          float old = measurements[i];
-          measurements[i] = prev;
-          prev = old;
-        }
-
-        float sum = 0;
-        for(int i = 0; i < 5; i++){
-          sum += measurements[i];
-        }
-        float average_current = sum / 5.0;
-
-        //AIRSPEED SENSOR READING
-        int raw = analogRead(AIRSPEED_PIN);
-        float airspeed_voltage = raw * (Vcc / 1023.0);
 
-        float pressure_kPa = (airspeed_voltage - zeroVoltage) / sensitivity; // Convert voltage to differential pressure in kPa
-        float pressure_Pa = pressure_kPa * 1000.0; // Convert kPa to Pascals
-
-        float airspeed = 0.0;          
-        if (pressure_Pa > 0) {
-          airspeed = sqrt((2.0 * pressure_Pa) / airDensity); // Compute airspeed using Bernoulli equation
-        }
-
-        //THRUST AND TORQUE SENSOR READINGS
-        float torque_data = TorqueSensor.getData();  
-        float thrust_data = ThrustSensor.getData();  
+      //the burst ring keeps sampling while the log is paused during a ramp
+      sample_burst();
+      if(TorqueSensor.update() && ThrustSensor.update()){
+        //every channel in the table is read and converted together
+        Channels::read();
+        Channels::convert();
+        update_live_readings(ThrustChannel::value, RPM);
 
         //RATE LIMIT THE WRITING TO AVOID OVERLOADING AND KEEP CONSISTENT DATAPOINTS
         if(!paused && millis() > last_serial_timestamp + SERIAL_PRINT_INTERVAL){     
           last_serial_timestamp = millis();
 
-          Serial.print(F("Current: ")); Serial.print(average_current);
-          Serial.print(F(" | Voltage: ")); Serial.print(voltage);
-          Serial.print(F(" | Torque: ")); Serial.print(torque_data);
-          Serial.print(F("| Thrust: ")); Serial.print(thrust_data);
-          Serial.print(F(" | RPM: ")); Serial.print(RPM);
-          Serial.print(F(" | AIRSPEED: ")); Serial.println(airspeed);
-          Serial.print(F(" | MEMORY: ")); Serial.println(free_memory());
-
-          data_file.print(average_current); data_file.print(", "); 
-          data_file.print(voltage); data_file.print(", ");
-          data_file.print(torque_data); data_file.print(", ");
-          data_file.print(thrust_data); data_file.print(", ");
-          data_file.print(RPM); data_file.print(", ");
-          data_file.println(airspeed);
+          Serial.print(F("Time (ms): ")); Serial.print(millis() - run_start_timestamp);
+          Channels::print_status(Serial);
+          Serial.print(F(" | MEMORY: ")); Serial.print(free_memory());
+          Serial.print(F(" | PEAK STACK: ")); Serial.println(peak_stack);
+
+          Channels::print_row(data_file, false);
           data_file.flush();
         }
       }
 
       //increment a rotation counter when the tachometer sees a marker pass by)
       increment();
+      drain_burst();
+    }
+  }
+
+  //handled even when the file failed to open, so the master waiting on ready after 'e' is always released
+  if(stop){ //If the signal to stop testing is recieved from master, close the file
+    if(raw_capture){
+      stop_raw_capture();
+    }
+    data_file.close();
+    burst_file.close();
+    if(next_run_queued){
+      Serial.println(F("Run closed, waiting for the next queued run"));
+      reset_run();
+      ready = true;
     }
-    else if(stop){ //If the signal to stop testing is recieved from master, close the file
-      data_file.close();
+    else{
       setup();
     }
   }
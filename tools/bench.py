@@ -0,0 +1,121 @@
+"""Runs the benchmark builds of both firmwares under simavr and compares them against the recorded baselines.
+
+Each project has a <board>_bench environment (see platformio.ini) that builds the real firmware with
+-D BENCHMARK. Instead of the normal setup() it times the conversion kernels, log writes and ramp code
+with Timer2 and prints "BENCH <name> <value>" lines, which this script collects. Cycle counts are per
+call; static_ram and peak_stack are in bytes.
+
+Usage:
+    python tools/bench.py              # run both, fail if anything is more than --tolerance worse
+    python tools/bench.py --update     # record the current numbers as the new baseline
+    python tools/bench.py slave        # run one project only
+
+A project with no baseline file, or a benchmark missing from it, fails the run until --update records it, so a
+fresh checkout or a renamed benchmark can't pass without anything being compared. The baselines in
+tools/bench_baselines/ are meant to be committed.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BASELINE_DIR = os.path.join(ROOT, "tools", "bench_baselines")
+PROJECTS = {
+    "master": ("motor_stand_master", "uno_bench"),
+    "slave": ("motor_stand_slave", "nanoatmega328_bench"),
+}
+BENCH_LINE = re.compile(r"BENCH (\w+) (\d+)")
+# Hard upper bounds checked on every run, whatever the baseline says
+LIMITS = {
+    "estop_trip": 1600,  # cycles (100 us at 16 MHz) from the e-stop edge to the ESC latched at minimum
+    "limit_trip_latency": 80000,  # cycles (5 ms) from an overcurrent on the slave to KILL_PIN low, SD write excluded
+    "estop_output_low": 33600,  # cycles (2.1 ms) from the edge to the ESC pin low; a 2 ms pulse may finish first
+}
+
+
+def run_benchmark(project_dir, env):
+    result = subprocess.run(["pio", "run", "-d", os.path.join(ROOT, project_dir), "-e", env, "-t", "upload"],
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True, timeout=600)
+    results = {}
+    for name, value in BENCH_LINE.findall(result.stdout):
+        results[name] = int(value)
+    if "done" not in results:
+        sys.stdout.write(result.stdout)
+        raise RuntimeError(env + " did not finish (no 'BENCH done' line)")
+    del results["done"]
+    return results
+
+
+def read_baseline(env):
+    path = os.path.join(BASELINE_DIR, env + ".txt")
+    baseline = {}
+    if os.path.exists(path):
+        with open(path) as f:
+            for line in f:
+                parts = line.split()
+                if len(parts) == 2:
+                    baseline[parts[0]] = int(parts[1])
+    return baseline
+
+
+def write_baseline(env, results):
+    os.makedirs(BASELINE_DIR, exist_ok=True)
+    with open(os.path.join(BASELINE_DIR, env + ".txt"), "w") as f:
+        for name in sorted(results):
+            f.write("{} {}\n".format(name, results[name]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("projects", nargs="*", help="master and/or slave (default: both)")
+    parser.add_argument("--update", action="store_true", help="overwrite the baselines with this run")
+    parser.add_argument("--tolerance", type=float, default=2.0, help="allowed regression in percent (default 2)")
+    args = parser.parse_args()
+
+    for key in args.projects:
+        if key not in PROJECTS:
+            parser.error("unknown project " + key)
+
+    regressions = 0
+    violations = 0
+    missing = 0
+    for key in args.projects or sorted(PROJECTS):
+        project_dir, env = PROJECTS[key]
+        results = run_benchmark(project_dir, env)
+        baseline = read_baseline(env)
+        if not baseline and not args.update:
+            print("{}: no baseline in {}; record one with --update".format(env, BASELINE_DIR))
+
+        print("{:<24}{:>10}{:>10}{:>9}".format(env, "value", "baseline", "change"))
+        for name in sorted(results):
+            value = results[name]
+            if name in baseline:
+                change = 100.0 * (value - baseline[name]) / baseline[name] if baseline[name] > 0 else 0.0
+                flag = "  REGRESSION" if change > args.tolerance else ""
+                regressions += bool(flag)
+                print("  {:<22}{:>10}{:>10}{:>8.1f}%{}".format(name, value, baseline[name], change, flag))
+            else:
+                missing += 1
+                print("  {:<22}{:>10}{:>10}{:>9}".format(name, value, "-", "new" if args.update else "MISSING"))
+            if name in LIMITS and value > LIMITS[name]:
+                violations += 1
+                print("  {:<22}{:>10} exceeds the limit of {}".format(name, value, LIMITS[name]))
+
+        if args.update:
+            write_baseline(env, results)
+
+    if violations:
+        print("{} benchmark(s) exceeded a hard limit".format(violations))
+    if regressions and not args.update:
+        print("{} benchmark(s) regressed by more than {}%".format(regressions, args.tolerance))
+    if missing and not args.update:
+        print("{} benchmark(s) have no baseline to compare against".format(missing))
+    if violations or ((regressions or missing) and not args.update):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,237 @@
+"""Breaks a firmware image down into flash, .data and .bss per module and per symbol, and checks it against budgets.
+
+Run it with "pio run -t memory_report" in either project. tools/memory_target.py adds that target, links with a
+map file and passes the budgets set in platformio.ini (custom_flash_budget, custom_ram_budget). It can also be
+run by hand on any AVR .elf:
+
+    python tools/memory_report.py firmware.elf --map firmware.map --budget flash=30720 --budget ram=1664
+    python tools/memory_report.py firmware.elf --budget burst_time=64 --top 40
+
+A budget can name a total (flash, ram, data, bss), a module (source file) or a symbol. "ram" is .data + .bss,
+which is the RAM used before the heap and the stack get any. Module and symbol budgets count RAM; add ":flash"
+(e.g. --budget SD.cpp:flash=6000) to budget their flash instead. Flash includes the initial values of .data.
+The script exits with status 1 when any budget is exceeded.
+
+Modules come from the debug line info (avr-nm -l) when the build has it. Otherwise they come from the linker map.
+With LTO, everything from the sketch shows up under one ltrans object in the map. Bytes not covered by a sized
+symbol (vectors, startup code, padding) are listed as "(unattributed)".
+"""
+
+import argparse
+import bisect
+import os
+import re
+import subprocess
+import sys
+
+MAP_OUTPUT_SECTION = re.compile(r"^(\.\w+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)")
+MAP_INPUT_SECTION = re.compile(r"^ (\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+MAP_INPUT_NAME = re.compile(r"^ (\S+)$")
+MAP_CONTINUATION = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+
+
+def run(args):
+    return subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True, check=True).stdout
+
+
+def read_sections(size_tool, elf):
+    """Address ranges of .text, .data and .bss from avr-size -A."""
+    sections = {}
+    for line in run([size_tool, "-A", elf]).splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[0] in (".text", ".data", ".bss", ".noinit"):
+            sections[parts[0]] = (int(parts[2]), int(parts[1]))
+    return sections
+
+
+def module_name(path):
+    """Short name for an object file or source path; archive members keep their archive."""
+    path = path.strip()
+    member = re.match(r"(.*)\((.*)\)$", path)
+    if member:
+        return "{}({})".format(os.path.basename(member.group(1)), module_name(member.group(2)))
+    name = os.path.basename(path)
+    for suffix in (".o", ".obj"):
+        if name.endswith(suffix):
+            name = name[:-len(suffix)]
+    return name
+
+
+def read_map(path):
+    """Sorted (start, end, module) ranges of every input section in the linker map."""
+    ranges = []
+    if not path or not os.path.exists(path):
+        return ranges
+    in_memory_map = False
+    pending = None
+    with open(path) as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if line.startswith("Linker script and memory map"):
+                in_memory_map = True
+                continue
+            if not in_memory_map:
+                continue
+            if MAP_OUTPUT_SECTION.match(line):
+                pending = None
+                continue
+            match = MAP_INPUT_SECTION.match(line)
+            if match:
+                start, size, source = int(match.group(2), 16), int(match.group(3), 16), match.group(4)
+            elif pending and MAP_CONTINUATION.match(line):
+                match = MAP_CONTINUATION.match(line)
+                start, size, source = int(match.group(1), 16), int(match.group(2), 16), match.group(3)
+            else:
+                name = MAP_INPUT_NAME.match(line)
+                pending = name.group(1) if name else None
+                continue
+            pending = None
+            if size > 0 and not source.startswith("load address"):
+                ranges.append((start, start + size, module_name(source)))
+    ranges.sort()
+    return ranges
+
+
+def map_module(ranges, starts, address):
+    i = bisect.bisect_right(starts, address) - 1
+    if i >= 0 and ranges[i][0] <= address < ranges[i][1]:
+        return ranges[i][2]
+    return None
+
+
+def read_symbols(nm_tool, elf, ranges):
+    """(name, address, size, module) for every sized symbol."""
+    starts = [r[0] for r in ranges]
+    symbols = []
+    seen = set()
+    for line in run([nm_tool, "-S", "-C", "-l", elf]).splitlines():
+        location = None
+        if "\t" in line:
+            line, location = line.split("\t", 1)
+        parts = line.split(None, 3)
+        if len(parts) < 4:
+            continue  # no size
+        address, size, kind, name = int(parts[0], 16), int(parts[1], 16), parts[2], parts[3]
+        if kind in "aAuUwvN" or size == 0 or (address, name) in seen:
+            continue
+        seen.add((address, name))
+        if location:
+            module = module_name(location.rsplit(":", 1)[0])
+        else:
+            module = map_module(ranges, starts, address) or "(unknown)"
+        symbols.append((name, address, size, module))
+    return symbols
+
+
+def region(sections, address):
+    for name in (".text", ".data", ".bss", ".noinit"):
+        if name in sections:
+            start, size = sections[name]
+            if start <= address < start + size:
+                return name
+    return None
+
+
+def tally(sections, symbols):
+    """Per-module and per-symbol byte counts split into flash, data and bss."""
+    modules = {}
+    attributed = {".text": 0, ".data": 0, ".bss": 0, ".noinit": 0}
+    symbol_rows = []
+    for name, address, size, module in symbols:
+        section = region(sections, address)
+        if section is None:
+            continue
+        attributed[section] += size
+        counts = modules.setdefault(module, {"flash": 0, "data": 0, "bss": 0})
+        if section == ".text":
+            counts["flash"] += size
+            symbol_rows.append((name, module, size, 0, 0))
+        elif section == ".data":
+            counts["data"] += size
+            counts["flash"] += size  # initial values are stored in flash and copied at startup
+            symbol_rows.append((name, module, size, size, 0))
+        else:
+            counts["bss"] += size
+            symbol_rows.append((name, module, 0, 0, size))
+    rest = {
+        "flash": sections.get(".text", (0, 0))[1] - attributed[".text"] + sections.get(".data", (0, 0))[1] - attributed[".data"],
+        "data": sections.get(".data", (0, 0))[1] - attributed[".data"],
+        "bss": sections.get(".bss", (0, 0))[1] + sections.get(".noinit", (0, 0))[1] - attributed[".bss"] - attributed[".noinit"],
+    }
+    if any(rest.values()):
+        modules["(unattributed)"] = rest
+    return modules, symbol_rows
+
+
+def print_table(title, header, rows):
+    print()
+    print(title)
+    print("  {:<48}{:>8}{:>8}{:>8}".format(*header))
+    for row in rows:
+        print("  {:<48}{:>8}{:>8}{:>8}".format(row[0][:47], *row[1:]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="linked firmware image")
+    parser.add_argument("--map", help="linker map for module attribution when there is no debug info")
+    parser.add_argument("--budget", action="append", default=[], metavar="NAME=BYTES",
+                        help="flash, ram, data, bss, a module or a symbol; may be repeated")
+    parser.add_argument("--top", type=int, default=25, help="symbols to list (default 25)")
+    parser.add_argument("--nm", default="avr-nm", help="nm tool (default avr-nm)")
+    parser.add_argument("--size", default="avr-size", help="size tool (default avr-size)")
+    args = parser.parse_args()
+
+    budgets = {}
+    for item in args.budget:
+        name, _, value = item.partition("=")
+        if not value.strip().isdigit():
+            parser.error("bad budget " + item)
+        budgets[name.strip()] = int(value)
+
+    sections = read_sections(args.size, args.elf)
+    symbols = read_symbols(args.nm, args.elf, read_map(args.map))
+    modules, symbol_rows = tally(sections, symbols)
+
+    data = sections.get(".data", (0, 0))[1]
+    bss = sections.get(".bss", (0, 0))[1] + sections.get(".noinit", (0, 0))[1]
+    totals = {"flash": sections.get(".text", (0, 0))[1] + data, "data": data, "bss": bss, "ram": data + bss}
+
+    print("MEMORY REPORT " + args.elf)
+    for name in ("flash", "ram", "data", "bss"):
+        limit = " / {}".format(budgets[name]) if name in budgets else ""
+        print("  {:<8}{:>8}{}".format(name, totals[name], limit))
+
+    module_rows = sorted(((m, c["flash"], c["data"], c["bss"]) for m, c in modules.items()),
+                         key=lambda r: (r[2] + r[3], r[1]), reverse=True)
+    print_table("PER MODULE", ("module", "flash", "data", "bss"), module_rows)
+
+    symbol_rows.sort(key=lambda r: (r[3] + r[4], r[2]), reverse=True)
+    print_table("TOP {} SYMBOLS (RAM first)".format(args.top), ("symbol", "flash", "data", "bss"),
+                [(name, flash, data, bss) for name, _, flash, data, bss in symbol_rows[:args.top]])
+
+    used = dict(totals)
+    for module, counts in modules.items():
+        used[module] = counts["data"] + counts["bss"]
+        used[module + ":flash"] = counts["flash"]
+    for name, _, flash, data, bss in symbol_rows:
+        used[name] = used.get(name, 0) + data + bss  # static locals of the same name in several modules add up
+        used[name + ":flash"] = used.get(name + ":flash", 0) + flash
+
+    failures = 0
+    print()
+    for name, limit in sorted(budgets.items()):
+        if name not in used:
+            print("BUDGET {}: no such section, module or symbol".format(name))
+            failures += 1
+        elif used[name] > limit:
+            print("BUDGET {}: {} bytes exceeds the budget of {}".format(name, used[name], limit))
+            failures += 1
+        else:
+            print("BUDGET {}: {} of {} bytes".format(name, used[name], limit))
+    if failures:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
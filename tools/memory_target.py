@@ -0,0 +1,33 @@
+"""PlatformIO extra script (see extra_scripts in platformio.ini): adds the memory_report target.
+
+    pio run -t memory_report
+
+It builds the firmware, then runs tools/memory_report.py on it with the environment's custom_flash_budget and
+custom_ram_budget, so the build fails when either is exceeded. It also links with a map file and keeps debug
+info in the .elf, which tools/memory_report.py uses to assign symbols to source files. Neither changes the
+image that gets uploaded.
+"""
+
+import os
+
+Import("env")  # noqa: F821 (provided by SCons)
+
+tools_dir = os.path.join(env.subst("$PROJECT_DIR"), os.pardir, "tools")  # noqa: F821
+map_path = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")  # noqa: F821
+
+env.Append(CCFLAGS=["-g"], LINKFLAGS=["-g", "-Wl,-Map," + map_path])  # noqa: F821
+
+budgets = []
+for name in ("flash", "ram"):
+    value = env.GetProjectOption("custom_{}_budget".format(name), "")  # noqa: F821
+    if value:
+        budgets.append("--budget {}={}".format(name, value))
+
+env.AddCustomTarget(  # noqa: F821
+    name="memory_report",
+    dependencies="$BUILD_DIR/${PROGNAME}.elf",
+    actions='"$PYTHONEXE" "{}" "$BUILD_DIR/${{PROGNAME}}.elf" --map "{}" {}'.format(
+        os.path.join(tools_dir, "memory_report.py"), map_path, " ".join(budgets)),
+    title="Memory report",
+    description="Flash, .data and .bss per module and symbol, checked against the budgets in platformio.ini",
+)
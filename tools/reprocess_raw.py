@@ -0,0 +1,169 @@
+"""Converts raw capture files (written by the slave when RAW CAPTURE is selected) into engineering units.
+
+The conversion math mirrors the kernels in motor_stand_slave.cpp. Every constant is read from the
+calibration snapshot at the top of the raw file and can be overridden on the command line, so a run
+with a bad tare can be recalibrated after the fact.
+
+The load cell columns are not raw ADC counts. They are HX711_ADC's getData() at a calibration factor
+of 1: the library's moving average (SAMPLES in its config.h, 16 by default) minus the tare offset the
+slave held during the run, which is *_TARE_OFFSET in the snapshot. Setting TORQUE_TARE_OFFSET or
+THRUST_TARE_OFFSET re-tares against the new offset (in the same smoothed counts) before scaling.
+
+Columns are matched by the names in the file's header row (see CONVERTED_NAMES), so adding a channel to the
+slave's table or reordering it doesn't break older or newer files. A column with no conversion here is copied
+through as logged; add it to CONVERTED_NAMES and reprocess() to convert it.
+
+Usage:
+    python reprocess_raw.py TEST_1.csv TEST_2.csv ...
+    python reprocess_raw.py --set ZERO_CURRENT_VOLTAGE=2.51 --set THRUST_CAL_FACTOR=-104.2 TEST_*.csv
+    python reprocess_raw.py --set THRUST_TARE_OFFSET=8412230 TEST_3.csv
+    python reprocess_raw.py --rpm-window 250 --current-taps 5 --out converted TEST_*.csv
+"""
+
+import argparse
+import csv
+import math
+import os
+import sys
+
+# Raw column (as the slave's channel table names it) -> converted column. Columns are found by these names, so
+# the order in the file doesn't matter; a raw column not listed here is copied through unconverted
+CONVERTED_NAMES = {
+    "Current (ADC)": "Current (A)",
+    "Voltage (ADC)": "Voltage (V)",
+    "Torque (counts)": "Torque (N.mm)",
+    "Thrust (counts)": "Thrust (N)",
+    "Tach edges": "RPM",
+    "Airspeed (ADC)": "Airspeed (m/s)",
+}
+DROPPED = {"Last edge (us)"}  # only needed on the device; RPM is recomputed from the edge count
+
+
+def read_raw_file(path):
+    """The calibration snapshot, the column names from the header row and the rows as dicts keyed by them."""
+    snapshot = {}
+    columns = None
+    rows = []
+    with open(path, newline="") as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            if line.startswith("#"):
+                parts = [p.strip() for p in line[1:].split(",")]
+                if len(parts) == 2:
+                    snapshot[parts[0]] = float(parts[1])
+                continue
+            if line.startswith("Time"):
+                columns = [p.strip() for p in line.split(",")]
+                continue
+            if columns is None:
+                raise ValueError(path + " has data before its header row")
+            rows.append(dict(zip(columns, (int(v) for v in line.split(",")))))
+    if "TORQUE_CAL_FACTOR" not in snapshot:
+        raise ValueError(path + " is not a raw capture file (no calibration snapshot)")
+    return snapshot, columns or [], rows
+
+
+def convert_current(raw, c):
+    current_voltage = raw * (c["Vcc"] / 1023.0)
+    return (current_voltage - c["ZERO_CURRENT_VOLTAGE"]) / c["CURRENT_SENSITIVITY"]
+
+
+def convert_voltage(raw, c):
+    return c["VOLTAGE_CALIBRATION"] * ((raw * (c["Vcc"] / 1023.0)) - c["ZERO_VOLTAGE"])
+
+
+def convert_airspeed(raw, c):
+    airspeed_voltage = raw * (c["Vcc"] / 1023.0)
+    pressure_pa = (airspeed_voltage - c["zeroVoltage"]) / c["sensitivity"] * 1000.0
+    if pressure_pa > 0:
+        return math.sqrt((2.0 * pressure_pa) / c["airDensity"])
+    return 0.0
+
+
+def convert_load_cell(counts, name, c, logged):
+    """Logged counts are relative to the tare the slave used; move them onto the (possibly overridden) tare, then scale."""
+    tare_name = name + "_TARE_OFFSET"
+    retare = logged.get(tare_name, 0.0) - c.get(tare_name, 0.0)
+    return (counts + retare) / c[name + "_CAL_FACTOR"]
+
+
+def output_header(columns):
+    return [CONVERTED_NAMES.get(name, name) for name in columns if name not in DROPPED]
+
+
+def reprocess(snapshot, columns, rows, rpm_window, current_taps, logged):
+    c = snapshot
+    out = []
+    current_history = []
+    window_start = 0  # index of the row the current RPM window opened on
+    rpm = 0.0
+    for i, row in enumerate(rows):
+        time_ms = row["Time (ms)"]
+        converted = []
+        for name in columns:
+            raw = row.get(name, 0)
+            if name in DROPPED:
+                continue
+            elif name == "Current (ADC)":
+                current_history.append(convert_current(raw, c))
+                current_history = current_history[-current_taps:]
+                converted.append(round(sum(current_history) / len(current_history), 3))
+            elif name == "Voltage (ADC)":
+                converted.append(round(convert_voltage(raw, c), 3))
+            elif name == "Torque (counts)":
+                converted.append(round(convert_load_cell(raw, "TORQUE", c, logged), 3))
+            elif name == "Thrust (counts)":
+                converted.append(round(convert_load_cell(raw, "THRUST", c, logged), 3))
+            elif name == "Tach edges":
+                # RPM from the edge count over a window, matching the slave's 250 ms update (two edges per marker)
+                elapsed = time_ms - rows[window_start]["Time (ms)"]
+                if elapsed >= rpm_window:
+                    revolutions = (raw - rows[window_start][name]) / (c["MARKERS"] * 2)
+                    rpm = revolutions * 60000.0 / elapsed
+                    window_start = i
+                converted.append(round(rpm, 1))
+            elif name == "Airspeed (ADC)":
+                converted.append(round(convert_airspeed(raw, c), 3))
+            else:
+                converted.append(raw)  # Time (ms), or a channel this script has no conversion for
+        out.append(converted)
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("files", nargs="+", help="raw capture CSV files from the slave SD card")
+    parser.add_argument("--set", action="append", default=[], metavar="NAME=VALUE",
+                        help="override a snapshot constant (e.g. a corrected tare or calibration factor)")
+    parser.add_argument("--rpm-window", type=float, default=250, help="RPM averaging window in ms (default 250)")
+    parser.add_argument("--current-taps", type=int, default=5, help="moving average length for current (default 5)")
+    parser.add_argument("--out", default=".", help="output directory (default: current directory)")
+    args = parser.parse_args()
+
+    overrides = {}
+    for item in args.set:
+        name, _, value = item.partition("=")
+        overrides[name.strip()] = float(value)
+
+    os.makedirs(args.out, exist_ok=True)
+    for path in args.files:
+        try:
+            snapshot, columns, rows = read_raw_file(path)
+        except ValueError as e:
+            print(e, file=sys.stderr)
+            continue
+        logged = dict(snapshot)
+        snapshot.update(overrides)
+
+        out_path = os.path.join(args.out, os.path.splitext(os.path.basename(path))[0] + "_converted.csv")
+        with open(out_path, "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(output_header(columns))
+            writer.writerows(reprocess(snapshot, columns, rows, args.rpm_window, args.current_taps, logged))
+        print("{} -> {} ({} rows)".format(path, out_path, len(rows)))
+
+
+if __name__ == "__main__":
+    main()